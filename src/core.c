@@ -20,24 +20,70 @@
  * SOFTWARE.
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include "core.h"
 #include "impl/__crypto.h"
+#include "impl/__fbase.h"
+#include "impl/__drbg.h"
+#include "impl/__kcache.h"
 
 ghibc_t gc;
 
-int __urandom_bytes(unsigned char *arr, size_t rc){
-	FILE *udr = fopen("/dev/urandom", "rb");
-	fread(arr, 1, rc, udr);
-	fclose(udr);
+static ghibc_ctx_t __ctx;
+static int __ctx_rc;
+static pthread_once_t __ctx_once = PTHREAD_ONCE_INIT;
+
+// buffered per thread generator, no syscall per call
+int __drbg_randbytes(unsigned char *arr, size_t rc){
+	__drbg_bytes(arr, rc);
 	return 0;
 }
 
-int ghibc_init(void){
-	gc.randbytes = &(__urandom_bytes);
+void __ghibc_stats(const ghibc_ctx_t *ctx, ghibc_stats_t *out){
+	__kcache_stats(ctx->kc, &out->kc_hits, &out->kc_misses, &out->kc_used);
+}
+
+static void __ghibc_initonce(void){
+	__ctx.randbytes = &(__drbg_randbytes);
 
-	int rc = __sodium_init();
+	__ctx_rc = __crypto_init(); //libsodium, then picks the backend
+	__ctx_rc += __fbase_init(); //generator tables for the signers and verifiers
+	__ctx.backend = __cb->name;
 
-	gc.ds = (ds_if_t *) &ds;
-	gc.ibi = (ibi_if_t *) &ibi;
-	return rc;
+	__ctx.ds = (ds_if_t *) &ds;
+	__ctx.ibi = (ibi_if_t *) &ibi;
+	__ctx.stats = &(__ghibc_stats);
+	__ctx.kc = NULL; //the process cache
+	gc = __ctx;
+}
+
+const ghibc_ctx_t *ghibc_ctx(void){
+	pthread_once(&__ctx_once, __ghibc_initonce);
+	return (__ctx_rc == 0) ? &__ctx : NULL;
+}
+
+ghibc_ctx_t *ghibc_ctx_new(void){
+	ghibc_ctx_t *out;
+	if( ghibc_ctx() == NULL ) return NULL;
+	out = (ghibc_ctx_t *)malloc(sizeof(ghibc_ctx_t));
+	if( out == NULL ) return NULL;
+	*out = __ctx;
+	out->kc = __kcache_new();
+	if( out->kc == NULL ){
+		free(out);
+		return NULL;
+	}
+	return out;
+}
+
+void ghibc_ctx_free(ghibc_ctx_t *ctx){
+	if( ctx == NULL || ctx == &__ctx || ctx == &gc ) return; //not created here
+	__kcache_free(ctx->kc);
+	free(ctx);
+}
+
+int ghibc_init(void){
+	pthread_once(&__ctx_once, __ghibc_initonce);
+	return __ctx_rc;
 }
@@ -25,16 +25,39 @@
 #include "impl/ds.h"
 #include "impl/ibi.h"
 
-//core utils
+typedef struct __ghibc_stats {
+	unsigned long kc_hits; //verifier key cache lookups
+	unsigned long kc_misses;
+	size_t kc_used; //cached identities
+} ghibc_stats_t;
+
+//library context. libsodium, the crypto backend and the generator tables
+//are set up once per process and only read afterwards. a context owns the
+//verifier key cache and the stats on it: the ibi verifier sessions take the
+//context they run on in verinit. the process context is there from the
+//first call, verifiers that must not share cached keys create their own.
+//contexts are thread safe, randbytes runs a per thread generator
 typedef struct __core {
 	int (*randbytes)(unsigned char *, size_t);
+	const char *backend; //crypto backend picked at init
 	//interfaces
 	ds_if_t *ds;
 	ibi_if_t *ibi;
-} ghibc_t;
+	void (*stats)(const struct __core *, ghibc_stats_t *);
+	struct __kcache *kc; //NULL: the cache of the process context
+} ghibc_ctx_t;
 
-extern ghibc_t gc;
+typedef ghibc_ctx_t ghibc_t;
 
+//the process context, NULL if the library failed to initialize
+const ghibc_ctx_t *ghibc_ctx(void);
+//a context with a key cache of its own, NULL on failure
+ghibc_ctx_t *ghibc_ctx_new(void);
+void ghibc_ctx_free(ghibc_ctx_t *);
+
+//older interface: gc is filled once by the first ghibc_init, later calls
+//only return the result
+extern ghibc_t gc;
 int ghibc_init(void);
 
 #endif
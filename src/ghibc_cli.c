@@ -127,6 +127,11 @@ int main(int argc, char *argv[], char *envp[]){
 
 	int rc;
 	char tcb[128]; size_t len;
+	const ghibc_ctx_t *ctx = ghibc_ctx();
+	if(ctx == NULL){
+		lerror("Unable to initialize the crypto library.\n");
+		return -1;
+	}
 
 	switch(arguments.mode){
 		case MSKGEN:
@@ -135,7 +140,7 @@ int main(int argc, char *argv[], char *envp[]){
 				return -1;
 			}
 			snprintf(tcb, 128, "%s.pub", arguments.mskfile);
-			rc = ghibfile.setup(arguments.mskfile, tcb, arguments.algo, arguments.flags);
+			rc = ghibfile.setup(ctx, arguments.mskfile, tcb, arguments.algo, arguments.flags);
 			printf("Master key generated to files %s and %s\n",arguments.mskfile, tcb);
 			break;
 		case USKGEN:
@@ -143,7 +148,7 @@ int main(int argc, char *argv[], char *envp[]){
 				lerror("Unspecified msk(-s)/usk(-u)/identity(-i) file in issue mode.\n");
 				return -1;
 			}
-			rc = ghibfile.issue(arguments.mskfile, arguments.uskfile, arguments.uident, arguments.flags);
+			rc = ghibfile.issue(ctx, arguments.mskfile, arguments.uskfile, arguments.uident, arguments.flags);
 			printf("User key (%s) generated to file %s.\n", arguments.uident, arguments.uskfile);
 			break;
 		case USKVRF:
@@ -151,7 +156,7 @@ int main(int argc, char *argv[], char *envp[]){
 				lerror("Unspecified mpk(-p)/usk(-u) file in validate mode.\n");
 				return -1;
 			}
-			rc = ghibfile.keycheck(arguments.mpkfile, arguments.uskfile, &arguments.uident, &len, arguments.flags);
+			rc = ghibfile.keycheck(ctx, arguments.mpkfile, arguments.uskfile, &arguments.uident, &len, arguments.flags);
 			if(rc == 0){
 				printf("User key (%s) on file %s is valid.\n", arguments.uident, arguments.uskfile);
 			}else{
@@ -167,7 +172,7 @@ int main(int argc, char *argv[], char *envp[]){
 				return -1;
 			}
 
-			ghibfile.agent(arguments.uskfile, arguments.flags);
+			ghibfile.agent(ctx, arguments.uskfile, arguments.flags);
 			// won't reach here
 			break;
 		case PINGVER:
@@ -177,7 +182,7 @@ int main(int argc, char *argv[], char *envp[]){
 			}
 
 			len = arguments.agsock ? strlen(arguments.agsock) : 0;
-			rc = ghibfile.pingver(arguments.mpkfile, arguments.uident, strlen(arguments.uident), arguments.agsock, len, arguments.flags);
+			rc = ghibfile.pingver(ctx, arguments.mpkfile, arguments.uident, strlen(arguments.uident), arguments.agsock, len, arguments.flags);
 			if(rc == 0){
 				printf("Ping verify succeed for id: %s.\n", arguments.uident);
 			}else{
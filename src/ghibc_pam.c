@@ -67,6 +67,10 @@ int pam_sm_authenticate(pam_handle_t *pamh, int flags, int argc, const char **ar
 	}
 	char *pkfname = (char *) argv[0];//store pkfilename
 
+	// library context, set up once per process
+	const ghibc_ctx_t *ctx = ghibc_ctx();
+	if(ctx == NULL) return PAM_AUTH_ERR;
+
 	// get username, 3rd arg is prompt "login:" (default).
 	rc = pam_get_user(pamh, (const char **) &user, "login: ");
 	if (rc != PAM_SUCCESS || user == NULL) {
@@ -104,8 +108,7 @@ int pam_sm_authenticate(pam_handle_t *pamh, int flags, int argc, const char **ar
 		//rmb to reset euid back to original 'euid'
 	}
 
-	ghibc_init();
-	rc = ghibfile.pingver(pkfname, user, strlen(user), asock, strlen(asock), 0);
+	rc = ghibfile.pingver(ctx, pkfname, user, strlen(user), asock, strlen(asock), 0);
 	switch(rc){
 		case GHIBC_NO_ERR:
 			//all ok
@@ -13,7 +13,7 @@
 #include <sys/stat.h>
 
 // generates the master key to a file, based on AN
-int __mastergen_file(char *skfilename, char *pkfilename, int an, int flags){
+int __mastergen_file(const ghibc_ctx_t *ctx, char *skfilename, char *pkfilename, int an, int flags){
 	void *sk, *pk;
 	unsigned char buf[GHIBC_BLEN]; size_t blen;
 
@@ -31,27 +31,26 @@ int __mastergen_file(char *skfilename, char *pkfilename, int an, int flags){
 		return GHIBC_FILE_ERR;
 	}
 
-	ghibc_init();
 
-	gc.ibi->setup(an, &sk, &pk);
+	ctx->ibi->setup(an, &sk, &pk);
 	if( flags & GHIBC_FLAG_VERBOSE ){
-		gc.ibi->kprint(sk);
-		gc.ibi->kprint(pk);
+		ctx->ibi->kprint(sk);
+		ctx->ibi->kprint(pk);
 	}
 
-	blen = gc.ibi->kserial(sk, buf, GHIBC_BLEN);
-	gc.ibi->kfree(sk);
+	blen = ctx->ibi->kserial(sk, buf, GHIBC_BLEN);
+	ctx->ibi->kfree(sk);
 	write_b64(skfile, buf, blen);
 	fclose(skfile);
 
-	blen = gc.ibi->kserial(pk, buf, GHIBC_BLEN);
-	gc.ibi->kfree(pk);
+	blen = ctx->ibi->kserial(pk, buf, GHIBC_BLEN);
+	ctx->ibi->kfree(pk);
 	write_b64(pkfile, buf, blen);
 	fclose(pkfile);
 	return GHIBC_NO_ERR;
 }
 
-int __usergen_file(char *skfilename, char *ukfilename, char *identity, int flags){
+int __usergen_file(const ghibc_ctx_t *ctx, char *skfilename, char *ukfilename, char *identity, int flags){
 	void *sk, *uk;
 	unsigned char *bptr; size_t blen;
 	unsigned char buf[GHIBC_BLEN];
@@ -70,31 +69,30 @@ int __usergen_file(char *skfilename, char *ukfilename, char *identity, int flags
 		return GHIBC_FILE_ERR;
 	}
 
-	ghibc_init();
 
 	bptr = read_b64(skfile, &blen);
 	fclose(skfile);
-	gc.ibi->kconstr(bptr, &sk);
+	ctx->ibi->kconstr(bptr, &sk);
 	free(bptr);
 
-	gc.ibi->issue(sk, identity, strlen(identity), &uk);
+	ctx->ibi->issue(sk, identity, strlen(identity), &uk);
 
 	if( flags & GHIBC_FLAG_VERBOSE ){
-		gc.ibi->kprint(sk);
-		gc.ibi->uprint(uk);
+		ctx->ibi->kprint(sk);
+		ctx->ibi->uprint(uk);
 	}
 
-	blen = gc.ibi->userial(uk, buf, GHIBC_BLEN);
+	blen = ctx->ibi->userial(uk, buf, GHIBC_BLEN);
 
-	gc.ibi->kfree(sk);
-	gc.ibi->ufree(uk);
+	ctx->ibi->kfree(sk);
+	ctx->ibi->ufree(uk);
 
 	write_b64(ukfile, buf, blen);
 	fclose(ukfile);
 	return GHIBC_NO_ERR;
 }
 
-int __userval_file(char *pkfilename, char *ukfilename, char **identity, size_t *idlen, int flags ){
+int __userval_file(const ghibc_ctx_t *ctx, char *pkfilename, char *ukfilename, char **identity, size_t *idlen, int flags ){
 	void *pk, *uk; int rc;
 	unsigned char *bptr; size_t blen;
 
@@ -112,27 +110,33 @@ int __userval_file(char *pkfilename, char *ukfilename, char **identity, size_t *
 		return GHIBC_FILE_ERR;
 	}
 
-	ghibc_init();
 
 	bptr = read_b64( pkfile, &blen);
 	fclose(pkfile);
-	gc.ibi->kconstr(bptr, &pk);
+	ctx->ibi->kconstr(bptr, &pk);
 	free(bptr);
 
 	bptr = read_b64( ukfile, &blen);
-	gc.ibi->uconstr(bptr, blen, &uk);
+	ctx->ibi->uconstr(bptr, blen, &uk);
 	free(bptr);
+	if( uk == NULL ){
+		if( flags & GHIBC_FLAG_VERBOSE )
+			lerror("Invalid user key in %s.\n", ukfilename);
+		ctx->ibi->kfree(pk);
+		fclose(ukfile);
+		return GHIBC_FAIL;
+	}
 
 	if( flags & GHIBC_FLAG_VERBOSE ){
-		gc.ibi->kprint(pk);
-		gc.ibi->uprint(uk);
+		ctx->ibi->kprint(pk);
+		ctx->ibi->uprint(uk);
 	}
 
-	gc.ibi->validate(pk, uk, &rc);
-	gc.ibi->kfree(pk);
-	gc.ibi->uiread(uk, (unsigned char **) identity, idlen);
+	ctx->ibi->validate(pk, uk, &rc);
+	ctx->ibi->kfree(pk);
+	ctx->ibi->uiread(uk, (unsigned char **) identity, idlen);
 
-	gc.ibi->ufree(uk);
+	ctx->ibi->ufree(uk);
 	fclose(ukfile);
 
 	if(rc){
@@ -142,7 +146,7 @@ int __userval_file(char *pkfilename, char *ukfilename, char **identity, size_t *
 	}
 }
 
-int __ping_verifier_file(char *pkfilename, char *uid, size_t uidlen, char *sp, size_t splen, int flags){
+int __ping_verifier_file(const ghibc_ctx_t *ctx, char *pkfilename, char *uid, size_t uidlen, char *sp, size_t splen, int flags){
 	//request for verification once on a socket
 	void *pk, *pst;
 	unsigned char *bptr; size_t blen;
@@ -161,17 +165,17 @@ int __ping_verifier_file(char *pkfilename, char *uid, size_t uidlen, char *sp, s
 	bptr = read_b64(pkfile, &blen);
 	fclose(pkfile);
 
-	ghibc_init();
-	gc.ibi->kconstr(bptr, &pk);
+	ctx->ibi->kconstr(bptr, &pk);
 	free(bptr);
-	an = gc.ibi->karead(pk);
+	ctx->ibi->kprep(pk); //decode before the round trips, protdc reuses it
+	an = ctx->ibi->karead(pk);
 
-	if( gc.ibi->cmtlen(an) > 320 || gc.ibi->reslen(an) > 320 ){
+	if( ctx->ibi->cmtlen(an) > 320 || ctx->ibi->reslen(an) > 320 ){
 		if( flags & GHIBC_FLAG_VERBOSE )
 			lerror("Insufficient recvbuffer size.\n");
 		rc =  GHIBC_BUFF_ERR;
 		goto teardown;
-	}else if( gc.ibi->chalen(an) > 64 ){
+	}else if( ctx->ibi->chalen(an) > 64 ){
 		if( flags & GHIBC_FLAG_VERBOSE )
 			lerror("Insufficient sendbuffer size.\n");
 		rc = GHIBC_BUFF_ERR;
@@ -220,13 +224,14 @@ int __ping_verifier_file(char *pkfilename, char *uid, size_t uidlen, char *sp, s
 		goto teardown;
 	}
 
-	gc.ibi->verinit(pk, (unsigned char *)uid, uidlen, &pst);
+	ctx->ibi->verinit(ctx, pk, (unsigned char *)uid, uidlen, &pst);
 
-	rc = recv(sd, rbuf, gc.ibi->cmtlen(an), 0);
-	gc.ibi->chagen(rbuf, &pst, sbuf);
-	rc = send(sd, sbuf, gc.ibi->chalen(an), 0);
-	rc = recv(sd, rbuf, gc.ibi->reslen(an), 0);
-	gc.ibi->protdc(rbuf, pst, &rc);
+	rc = recv(sd, rbuf, ctx->ibi->cmtlen(an), 0);
+	ctx->ibi->chagen(rbuf, &pst, sbuf);
+	rc = send(sd, sbuf, ctx->ibi->chalen(an), 0);
+	ctx->ibi->verpre(pst); //while the response is on its way
+	rc = recv(sd, rbuf, ctx->ibi->reslen(an), 0);
+	ctx->ibi->protdc(rbuf, pst, &rc);
 	if(rc == 0){
 		rc = GHIBC_NO_ERR;
 	}else{
@@ -235,11 +240,11 @@ int __ping_verifier_file(char *pkfilename, char *uid, size_t uidlen, char *sp, s
 	close(sd);
 
 teardown:
-	gc.ibi->kfree(pk);
+	ctx->ibi->kfree(pk);
 	return rc;
 }
 
-int __prover_unix_agent_file(char *ukfilename, int flags){
+int __prover_unix_agent_file(const ghibc_ctx_t *ctx, char *ukfilename, int flags){
 	void *uk, *pst;
 	unsigned char *bptr; size_t blen;
 	int an, rc, sd, cd;
@@ -256,21 +261,25 @@ int __prover_unix_agent_file(char *ukfilename, int flags){
 		return GHIBC_FILE_ERR;
 	}
 
-	ghibc_init();
 
 	bptr = read_b64( ukfile, &blen);
 	fclose(ukfile);
-	gc.ibi->uconstr(bptr, blen, &uk);
+	ctx->ibi->uconstr(bptr, blen, &uk);
 	free(bptr);
+	if( uk == NULL ){
+		if( flags & GHIBC_FLAG_VERBOSE )
+			lerror("Invalid user key in %s.\n", ukfilename);
+		return GHIBC_FAIL;
+	}
 
-	an = gc.ibi->uaread(uk);
+	an = ctx->ibi->uaread(uk);
 
-	if( gc.ibi->cmtlen(an) > 320 || gc.ibi->reslen(an) > 320 ){
+	if( ctx->ibi->cmtlen(an) > 320 || ctx->ibi->reslen(an) > 320 ){
 		if( flags & GHIBC_FLAG_VERBOSE )
 			lerror("Insufficient sendbuffer size.\n");
 		rc = GHIBC_BUFF_ERR;
 		goto teardown;
-	}else if( gc.ibi->chalen(an) > 64 ){
+	}else if( ctx->ibi->chalen(an) > 64 ){
 		if( flags & GHIBC_FLAG_VERBOSE )
 			lerror("Insufficient recvbuffer size.\n");
 		rc = GHIBC_BUFF_ERR;
@@ -326,6 +335,9 @@ int __prover_unix_agent_file(char *ukfilename, int flags){
 	fprintf(stdout, "GHIBC_AGENT_PID=%d; export GHIBC_AGENT_PID;\n", pid);
 	fprintf(stdout, "echo Agent pid %d\n", pid);
 
+	//commitments are precomputed between requests, failure leaves online sampling
+	ctx->ibi->uprep(uk, GHIBC_CMTPOOL);
+
 	time_t rtime;
   	struct tm * tinfo;
 	//TODO: properly handle keyboard interrupts and teardown nicely
@@ -337,23 +349,23 @@ int __prover_unix_agent_file(char *ukfilename, int flags){
 			fprintf(stdout, "Prove request at: %s", asctime(tinfo));
 		}
 
-		gc.ibi->prvinit(uk, &pst); //initialize prover
-		gc.ibi->cmtgen(&pst, sbuf);
+		ctx->ibi->prvinit(uk, &pst); //initialize prover
+		ctx->ibi->cmtgen(&pst, sbuf);
 
-		rc = send(cd, sbuf, gc.ibi->cmtlen(an), 0);
-		assert( rc == gc.ibi->cmtlen(an));
+		rc = send(cd, sbuf, ctx->ibi->cmtlen(an), 0);
+		assert( rc == ctx->ibi->cmtlen(an));
 
-		rc = recv(cd, rbuf, gc.ibi->chalen(an), 0);
-		assert( rc == gc.ibi->chalen(an));
+		rc = recv(cd, rbuf, ctx->ibi->chalen(an), 0);
+		assert( rc == ctx->ibi->chalen(an));
 
-		gc.ibi->resgen(rbuf, pst, sbuf);
-		rc = send(cd, sbuf, gc.ibi->reslen(an), 0);
-		assert( rc == gc.ibi->reslen(an));
+		ctx->ibi->resgen(rbuf, pst, sbuf);
+		rc = send(cd, sbuf, ctx->ibi->reslen(an), 0);
+		assert( rc == ctx->ibi->reslen(an));
 		close(cd);
 	}
 	//won't reach, but cleanup code for further use
 teardown:
-	gc.ibi->ufree(uk);
+	ctx->ibi->ufree(uk);
 	return rc;
 }
 
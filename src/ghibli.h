@@ -23,7 +23,7 @@
 #ifndef __GHIBLI_H__
 #define __GHIBLI_H__
 
-//PLEASE call cryptoinit() before using the library
+//every entry point takes the library context, see ghibc_ctx() in core.h
 
 #include "core.h"
 
@@ -39,13 +39,14 @@
 #define GHIBC_FLAG_VERBOSE 0x02 // verbosity flag
 
 #define GHIBC_BLEN 512
+#define GHIBC_CMTPOOL 16 // precomputed commitments kept by the agent
 
 struct __ghibli_file {
-	int (*setup)(char *, char *, int, int);
-	int (*issue)(char *, char *, char *, int);
-	int (*keycheck)(char *, char *, char **, size_t *, int);
-	int (*agent)(char *, int);
-	int (*pingver)(char *, char *, size_t, char *, size_t, int);
+	int (*setup)(const ghibc_ctx_t *, char *, char *, int, int);
+	int (*issue)(const ghibc_ctx_t *, char *, char *, char *, int);
+	int (*keycheck)(const ghibc_ctx_t *, char *, char *, char **, size_t *, int);
+	int (*agent)(const ghibc_ctx_t *, char *, int);
+	int (*pingver)(const ghibc_ctx_t *, char *, char *, size_t, char *, size_t, int);
 };
 
 extern const struct __ghibli_file ghibfile;
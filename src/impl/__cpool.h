@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __CPOOL_H__
+#define __CPOOL_H__
+
+// prover side pool of precomputed commitments (offline/online split)
+// entries are (n1, n2, T) with T = n1B (heng04) or n1B + n2B2 (chin15)
+// kept in guarded, locked memory and refilled by a background thread.
+// a forked child never pops entries created by its parent
+
+#include "__fbase.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct __cpool cpool_t;
+
+// B2t NULL for single nonce schemes, starts the refill thread
+cpool_t *__cpool_new(ge_fbase_t *, size_t);
+void __cpool_free(cpool_t *);
+
+// 0 and the entry is moved out (n2 may be NULL), -1 if nothing is ready
+int __cpool_pop(cpool_t *, uint8_t *, uint8_t *, uint8_t *);
+
+#endif
@@ -28,9 +28,48 @@
 #define RRS crypto_core_ristretto255_SCALARBYTES
 #define RRH crypto_core_ristretto255_HASHBYTES
 
+#include <stddef.h>
+#include <stdint.h>
+
+// crypto backend, the schemes reach scalar, point, hash and random
+// primitives through __cb only. libsodium is the reference backend, the
+// in-tree one (ULNATIVE) is picked by __crypto_init when the cpu allows
+typedef struct __crypto_backend {
+	const char *name;
+	//scalars mod l, RRS bytes, outputs reduced
+	void (*scrand)(uint8_t *);
+	void (*screduce)(uint8_t *, const uint8_t *); //RRH byte input
+	void (*scadd)(uint8_t *, const uint8_t *, const uint8_t *);
+	void (*scsub)(uint8_t *, const uint8_t *, const uint8_t *);
+	void (*scmul)(uint8_t *, const uint8_t *, const uint8_t *);
+	void (*scneg)(uint8_t *, const uint8_t *);
+	//ristretto255 points, RRE bytes
+	int (*ptbase)(uint8_t *, const uint8_t *); //nB, constant time, -1 on identity
+	int (*ptbase_n)(size_t, uint8_t *, const uint8_t *); //n consecutive ptbase
+	void (*ptrand)(uint8_t *); //element with unknown discrete log
+	//H(m || u || v) mod l, single and n independent messages
+	void (*h2s)(const uint8_t *, size_t, const uint8_t *, const uint8_t *, uint8_t *);
+	void (*h2s_n)(size_t, const uint8_t *const *, const size_t *,
+			const uint8_t *const *, const uint8_t *const *, uint8_t *);
+	void (*randbytes)(uint8_t *, size_t);
+} crypto_backend_t;
+
+extern const crypto_backend_t *__cb; //selected backend, sodium until init
+extern const crypto_backend_t __cb_sodium;
+extern const crypto_backend_t __cb_native; //only built with ULNATIVE
+int __cb_native_ok(void); //cpu check for __cb_native
+
 //cryptographic backend initialization functions
 int __sodium_init();
+int __crypto_init(void);
 // sodium based hash functions
 void __sodium_2rinhashexec(const uint8_t *, size_t, uint8_t *, uint8_t *, uint8_t *);
 
+// hash-to-scalar choices carried by the keys, x = H(m || u || v) mod l
+#define H2S_SHA512  0 //through the backend (__cb->h2s), the original schemes
+#define H2S_BLAKE2B 1 //BLAKE2b-512 keyed with a domain tag (the *b schemes)
+void __h2s(uint8_t, const uint8_t *, size_t, const uint8_t *, const uint8_t *, uint8_t *);
+void __h2s_n(uint8_t, size_t, const uint8_t *const *, const size_t *,
+		const uint8_t *const *, const uint8_t *const *, uint8_t *);
+
 #endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DCQ_H__
+#define __DCQ_H__
+
+// deferred decision queue for the verifiers of heng04/chin15 (and their
+// variants). every queued transcript is put in the form
+//   y1 B + y2 B2 - cU' + (cx) A - T == 0,  x = H(id, U', A)
+// and a flush settles all of them with one randomized multi-scalar check
+// (K = U' - xA is never formed, equal A and B2 share a single term).
+// failing batches are bisected, each session gets its own callback.
+// callbacks run on the thread that fills or flushes the queue, or on the
+// queue's timer thread once the latency bound expires
+
+#include "__ge25519.h"
+#include "__fbase.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// one decoded transcript, filled by the scheme's dcprep
+struct __ibi_dcent {
+	ge_p3_t U, T, A;
+	uint8_t Ab[32]; //encoded A, equal keys share a term
+	ge_fbase_t *At; //prepared A (reference held), NULL if A is decoded
+	ge_fbase_t *B2t; //second base (reference held), NULL for one base schemes
+	uint8_t y1[32], y2[32], c[32], cx[32];
+	void (*cb)(void *, int);
+	void *arg;
+};
+
+typedef struct __dcq dcq_t;
+
+// a queue of up to n sessions, lat is the longest a session waits (in us,
+// 0 for none: only a full queue or dcqflush decides)
+dcq_t *__dcq_new(size_t, unsigned long);
+// takes the entry (and its references), flushes if the queue is full
+void __dcq_push(dcq_t *, const struct __ibi_dcent *);
+void __dcq_flush(dcq_t *);
+void __dcq_free(dcq_t *); //decides what is still pending
+
+#endif
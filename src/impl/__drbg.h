@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DRBG_H__
+#define __DRBG_H__
+
+// per thread ChaCha20 generator behind all the randomness of the library.
+// output is buffered with fast key erasure (the first block of every refill
+// becomes the next key, handed out bytes are wiped), seeded from getrandom
+// on first use in a thread, after fork() and every DRBG_RESEED bytes
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DRBG_BUFLEN 768 //keystream per refill, the first 32 bytes rekey
+#define DRBG_RESEED (1 << 20) //output between two seeds
+
+void __drbg_bytes(uint8_t *, size_t);
+
+#endif
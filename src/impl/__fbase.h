@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __FBASE_H__
+#define __FBASE_H__
+
+// precomputed tables for fixed bases (the generator B and the per-master
+// second base B2 of chin15). tables are shared and reference counted,
+// every key object carrying the same base points to a single table
+
+#include "__ge25519.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define FBASE_ODDW 8 //wnaf width of the odd table
+#define FBASE_ODDN (1 << (FBASE_ODDW-2))
+
+typedef struct __ge_fbase {
+	uint8_t enc[32]; //ristretto255 encoding, registry key
+	ge_p3_t P;
+	ge_precomp_t (*comb)[8]; //(j+1) 256^i P, constant time path (NULL if unused)
+	ge_cached_t odd[FBASE_ODDN]; //P, 3P, ..., 127P, variable time path
+	void *odd4; //the same for the ifma kernel (NULL without it)
+	struct __ge_fbase *hi; //tables for 2^128 P, built by __fbase_hi (NULL until then)
+	size_t refs;
+	struct __ge_fbase *next;
+} ge_fbase_t;
+
+// tables for the generator, built by __fbase_init
+extern ge_fbase_t __fbase_B;
+
+// builds the generator tables, idempotent (called from ghibc_init)
+int __fbase_init(void);
+
+// returns the shared tables for the encoded point, building them on first
+// use. the comb is only built if ct is set (points used with secret scalars)
+// NULL if the point does not decode (or out of memory)
+ge_fbase_t *__fbase_acquire(const uint8_t *, int);
+ge_fbase_t *__fbase_dup(ge_fbase_t *);
+void __fbase_release(ge_fbase_t *);
+
+// variable time tables for 2^128 P, built on first use and owned by f, so
+// a public a = a0 + 2^128 a1 runs as a0 P + a1 (2^128 P) on half the
+// doublings. NULL if out of memory
+const ge_fbase_t *__fbase_hi(ge_fbase_t *);
+
+// h = aP in constant time, a must be < 2^255 (any reduced scalar)
+// the tables must have been acquired with ct set
+void __fbase_smul(ge_p3_t *, const uint8_t *, const ge_fbase_t *);
+
+// h[i] = a_i P for n consecutive scalars, four per step on the avx2 kernel
+void __fbase_smul_n(ge_p3_t *, const uint8_t *, size_t, const ge_fbase_t *);
+
+// out = aP + bQ encoded, constant time. -1 if either table has no comb
+int __fbase_smul2(uint8_t *, const uint8_t *, const ge_fbase_t *, const uint8_t *, const ge_fbase_t *);
+
+// n consecutive encodings a_i P + b_i Q (Q may be NULL, b is then unused)
+// for bulk issuance: four lanes per comb step and one field inversion for
+// all encodings. scalars must be reduced, -1 as above or out of memory
+int __fbase_smul2_n(uint8_t *, const uint8_t *, const ge_fbase_t *,
+		const uint8_t *, const ge_fbase_t *, size_t);
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __FE25519_H__
+#define __FE25519_H__
+
+// field arithmetic over GF(2^255-19), radix 2^51 (5 x 64bit limbs)
+// used internally by the group layer (ge25519.c) so that points may stay
+// decoded across a whole equation instead of round-tripping through the
+// 32 byte ristretto255 encoding on every libsodium call
+
+#include <stdint.h>
+#include <string.h>
+
+typedef unsigned __int128 __u128;
+
+typedef struct __fe {
+	uint64_t v[5];
+} fe_t;
+
+#define FE_MASK51 ((uint64_t)0x7ffffffffffff)
+
+static inline void __fe_0(fe_t *h){
+	memset(h, 0, sizeof(fe_t));
+}
+
+static inline void __fe_1(fe_t *h){
+	memset(h, 0, sizeof(fe_t));
+	h->v[0] = 1;
+}
+
+static inline void __fe_copy(fe_t *h, const fe_t *f){
+	memcpy(h, f, sizeof(fe_t));
+}
+
+//weak reduction, limbs end up < 2^51 + 2^13*19
+static inline void __fe_carry(fe_t *h){
+	uint64_t c;
+	c = h->v[0] >> 51; h->v[0] &= FE_MASK51; h->v[1] += c;
+	c = h->v[1] >> 51; h->v[1] &= FE_MASK51; h->v[2] += c;
+	c = h->v[2] >> 51; h->v[2] &= FE_MASK51; h->v[3] += c;
+	c = h->v[3] >> 51; h->v[3] &= FE_MASK51; h->v[4] += c;
+	c = h->v[4] >> 51; h->v[4] &= FE_MASK51; h->v[0] += c*19;
+}
+
+// h = f + g
+static inline void __fe_add(fe_t *h, const fe_t *f, const fe_t *g){
+	h->v[0] = f->v[0] + g->v[0];
+	h->v[1] = f->v[1] + g->v[1];
+	h->v[2] = f->v[2] + g->v[2];
+	h->v[3] = f->v[3] + g->v[3];
+	h->v[4] = f->v[4] + g->v[4];
+	__fe_carry(h);
+}
+
+// h = f - g (computed as f + 4p - g to stay positive)
+static inline void __fe_sub(fe_t *h, const fe_t *f, const fe_t *g){
+	h->v[0] = (f->v[0] + 0x1fffffffffffb4) - g->v[0];
+	h->v[1] = (f->v[1] + 0x1ffffffffffffc) - g->v[1];
+	h->v[2] = (f->v[2] + 0x1ffffffffffffc) - g->v[2];
+	h->v[3] = (f->v[3] + 0x1ffffffffffffc) - g->v[3];
+	h->v[4] = (f->v[4] + 0x1ffffffffffffc) - g->v[4];
+	__fe_carry(h);
+}
+
+// h = -f
+static inline void __fe_neg(fe_t *h, const fe_t *f){
+	fe_t z; __fe_0(&z);
+	__fe_sub(h, &z, f);
+}
+
+// h = f * g
+static inline void __fe_mul(fe_t *h, const fe_t *f, const fe_t *g){
+	const uint64_t f0 = f->v[0], f1 = f->v[1], f2 = f->v[2], f3 = f->v[3], f4 = f->v[4];
+	const uint64_t g0 = g->v[0], g1 = g->v[1], g2 = g->v[2], g3 = g->v[3], g4 = g->v[4];
+	const uint64_t g1_19 = 19*g1, g2_19 = 19*g2, g3_19 = 19*g3, g4_19 = 19*g4;
+	__u128 r0, r1, r2, r3, r4;
+	uint64_t c;
+
+	r0 = (__u128)f0*g0 + (__u128)f1*g4_19 + (__u128)f2*g3_19 + (__u128)f3*g2_19 + (__u128)f4*g1_19;
+	r1 = (__u128)f0*g1 + (__u128)f1*g0 + (__u128)f2*g4_19 + (__u128)f3*g3_19 + (__u128)f4*g2_19;
+	r2 = (__u128)f0*g2 + (__u128)f1*g1 + (__u128)f2*g0 + (__u128)f3*g4_19 + (__u128)f4*g3_19;
+	r3 = (__u128)f0*g3 + (__u128)f1*g2 + (__u128)f2*g1 + (__u128)f3*g0 + (__u128)f4*g4_19;
+	r4 = (__u128)f0*g4 + (__u128)f1*g3 + (__u128)f2*g2 + (__u128)f3*g1 + (__u128)f4*g0;
+
+	c = (uint64_t)(r0 >> 51); h->v[0] = (uint64_t)r0 & FE_MASK51; r1 += c;
+	c = (uint64_t)(r1 >> 51); h->v[1] = (uint64_t)r1 & FE_MASK51; r2 += c;
+	c = (uint64_t)(r2 >> 51); h->v[2] = (uint64_t)r2 & FE_MASK51; r3 += c;
+	c = (uint64_t)(r3 >> 51); h->v[3] = (uint64_t)r3 & FE_MASK51; r4 += c;
+	c = (uint64_t)(r4 >> 51); h->v[4] = (uint64_t)r4 & FE_MASK51;
+	h->v[0] += c*19;
+	c = h->v[0] >> 51; h->v[0] &= FE_MASK51; h->v[1] += c;
+}
+
+// h = f^2
+static inline void __fe_sq(fe_t *h, const fe_t *f){
+	const uint64_t f0 = f->v[0], f1 = f->v[1], f2 = f->v[2], f3 = f->v[3], f4 = f->v[4];
+	const uint64_t f0_2 = 2*f0, f1_2 = 2*f1;
+	const uint64_t f1_38 = 38*f1, f2_38 = 38*f2, f3_38 = 38*f3;
+	const uint64_t f3_19 = 19*f3, f4_19 = 19*f4;
+	__u128 r0, r1, r2, r3, r4;
+	uint64_t c;
+
+	r0 = (__u128)f0*f0 + (__u128)f1_38*f4 + (__u128)f2_38*f3;
+	r1 = (__u128)f0_2*f1 + (__u128)f2_38*f4 + (__u128)f3_19*f3;
+	r2 = (__u128)f0_2*f2 + (__u128)f1*f1 + (__u128)f3_38*f4;
+	r3 = (__u128)f0_2*f3 + (__u128)f1_2*f2 + (__u128)f4_19*f4;
+	r4 = (__u128)f0_2*f4 + (__u128)f1_2*f3 + (__u128)f2*f2;
+
+	c = (uint64_t)(r0 >> 51); h->v[0] = (uint64_t)r0 & FE_MASK51; r1 += c;
+	c = (uint64_t)(r1 >> 51); h->v[1] = (uint64_t)r1 & FE_MASK51; r2 += c;
+	c = (uint64_t)(r2 >> 51); h->v[2] = (uint64_t)r2 & FE_MASK51; r3 += c;
+	c = (uint64_t)(r3 >> 51); h->v[3] = (uint64_t)r3 & FE_MASK51; r4 += c;
+	c = (uint64_t)(r4 >> 51); h->v[4] = (uint64_t)r4 & FE_MASK51;
+	h->v[0] += c*19;
+	c = h->v[0] >> 51; h->v[0] &= FE_MASK51; h->v[1] += c;
+}
+
+// h = f^(2^n)
+static inline void __fe_sqn(fe_t *h, const fe_t *f, int n){
+	__fe_sq(h, f);
+	while(--n > 0) __fe_sq(h, h);
+}
+
+// conditional move, f = g if b == 1 (constant time)
+static inline void __fe_cmov(fe_t *f, const fe_t *g, unsigned int b){
+	const uint64_t m = (uint64_t)0 - (uint64_t)b;
+	for(int i=0;i<5;i++) f->v[i] ^= m & (f->v[i] ^ g->v[i]);
+}
+
+// canonical little endian encoding
+static inline void __fe_tobytes(uint8_t *s, const fe_t *f){
+	fe_t t; uint64_t q;
+	__fe_copy(&t, f);
+	__fe_carry(&t);
+	__fe_carry(&t);
+	// q = 1 iff t >= p
+	q = (t.v[0] + 19) >> 51;
+	q = (t.v[1] + q) >> 51;
+	q = (t.v[2] + q) >> 51;
+	q = (t.v[3] + q) >> 51;
+	q = (t.v[4] + q) >> 51;
+	t.v[0] += 19*q;
+	t.v[1] += t.v[0] >> 51; t.v[0] &= FE_MASK51;
+	t.v[2] += t.v[1] >> 51; t.v[1] &= FE_MASK51;
+	t.v[3] += t.v[2] >> 51; t.v[2] &= FE_MASK51;
+	t.v[4] += t.v[3] >> 51; t.v[3] &= FE_MASK51;
+	t.v[4] &= FE_MASK51;
+
+	const uint64_t w0 = t.v[0] | (t.v[1] << 51);
+	const uint64_t w1 = (t.v[1] >> 13) | (t.v[2] << 38);
+	const uint64_t w2 = (t.v[2] >> 26) | (t.v[3] << 25);
+	const uint64_t w3 = (t.v[3] >> 39) | (t.v[4] << 12);
+	for(int i=0;i<8;i++){
+		s[i]    = (uint8_t)(w0 >> (8*i));
+		s[i+8]  = (uint8_t)(w1 >> (8*i));
+		s[i+16] = (uint8_t)(w2 >> (8*i));
+		s[i+24] = (uint8_t)(w3 >> (8*i));
+	}
+}
+
+// decode, top bit ignored (callers check canonicity if required)
+static inline void __fe_frombytes(fe_t *h, const uint8_t *s){
+	uint64_t w[4];
+	for(int i=0;i<4;i++){
+		w[i] = 0;
+		for(int j=7;j>=0;j--) w[i] = (w[i] << 8) | s[8*i+j];
+	}
+	h->v[0] = w[0] & FE_MASK51;
+	h->v[1] = ((w[0] >> 51) | (w[1] << 13)) & FE_MASK51;
+	h->v[2] = ((w[1] >> 38) | (w[2] << 26)) & FE_MASK51;
+	h->v[3] = ((w[2] >> 25) | (w[3] << 39)) & FE_MASK51;
+	h->v[4] = (w[3] >> 12) & FE_MASK51;
+}
+
+static inline int __fe_isnegative(const fe_t *f){
+	uint8_t s[32];
+	__fe_tobytes(s, f);
+	return s[0] & 1;
+}
+
+static inline int __fe_iszero(const fe_t *f){
+	uint8_t s[32], d = 0;
+	__fe_tobytes(s, f);
+	for(int i=0;i<32;i++) d |= s[i];
+	return ((unsigned int)d - 1) >> 31; // 1 if zero
+}
+
+static inline int __fe_eq(const fe_t *f, const fe_t *g){
+	fe_t t;
+	__fe_sub(&t, f, g);
+	return __fe_iszero(&t);
+}
+
+// f = -f if b == 1
+static inline void __fe_cneg(fe_t *f, unsigned int b){
+	fe_t t;
+	__fe_neg(&t, f);
+	__fe_cmov(f, &t, b);
+}
+
+// h = |f|
+static inline void __fe_abs(fe_t *h, const fe_t *f){
+	__fe_copy(h, f);
+	__fe_cneg(h, __fe_isnegative(f));
+}
+
+// field constants (ge25519.c)
+extern const fe_t __fe_d;
+extern const fe_t __fe_d2;
+extern const fe_t __fe_sqrtm1;
+extern const fe_t __fe_invsqrt_a_minus_d;
+
+void __fe_invert(fe_t *, const fe_t *);
+void __fe_pow22523(fe_t *, const fe_t *);
+int __fe_sqrt_ratio_m1(fe_t *, const fe_t *, const fe_t *);
+
+#endif
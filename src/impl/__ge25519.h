@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __GE25519_H__
+#define __GE25519_H__
+
+// edwards25519 group arithmetic in extended coordinates with a ristretto255
+// encoding at the boundary. points are decoded once per equation and only
+// re-encoded when a caller really needs the 32 byte form
+
+#include "__fe25519.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// projective (X:Y:Z)
+typedef struct __ge_p2 {
+	fe_t X, Y, Z;
+} ge_p2_t;
+
+// extended (X:Y:Z:T), XY = ZT
+typedef struct __ge_p3 {
+	fe_t X, Y, Z, T;
+} ge_p3_t;
+
+// completed ((X:Z),(Y:T))
+typedef struct __ge_p1p1 {
+	fe_t X, Y, Z, T;
+} ge_p1p1_t;
+
+// cached addend (Y+X, Y-X, Z, 2dT)
+typedef struct __ge_cached {
+	fe_t YplusX, YminusX, Z, T2d;
+} ge_cached_t;
+
+// affine addend (y+x, y-x, 2dxy)
+typedef struct __ge_precomp {
+	fe_t yplusx, yminusx, xy2d;
+} ge_precomp_t;
+
+extern const ge_p3_t __ge_basepoint;
+
+void __ge_p3_0(ge_p3_t *);
+void __ge_p3_to_p2(ge_p2_t *, const ge_p3_t *);
+void __ge_p3_to_cached(ge_cached_t *, const ge_p3_t *);
+void __ge_p1p1_to_p2(ge_p2_t *, const ge_p1p1_t *);
+void __ge_p1p1_to_p3(ge_p3_t *, const ge_p1p1_t *);
+void __ge_p2_dbl(ge_p1p1_t *, const ge_p2_t *);
+void __ge_p3_dbl(ge_p1p1_t *, const ge_p3_t *);
+void __ge_add(ge_p1p1_t *, const ge_p3_t *, const ge_cached_t *);
+void __ge_sub(ge_p1p1_t *, const ge_p3_t *, const ge_cached_t *);
+void __ge_madd(ge_p1p1_t *, const ge_p3_t *, const ge_precomp_t *);
+void __ge_msub(ge_p1p1_t *, const ge_p3_t *, const ge_precomp_t *);
+
+// r = p + q, r = p - q (r may alias either input)
+void __ge_p3_add(ge_p3_t *, const ge_p3_t *, const ge_p3_t *);
+void __ge_p3_sub(ge_p3_t *, const ge_p3_t *, const ge_p3_t *);
+// r = -p (r may alias p)
+void __ge_p3_neg(ge_p3_t *, const ge_p3_t *);
+
+// ristretto255 codec, frombytes returns 0 on success (-1 if not canonical)
+int __ge_frombytes(ge_p3_t *, const uint8_t *);
+void __ge_tobytes(uint8_t *, const ge_p3_t *);
+// encodings of 2p[i] for n points sharing a single field inversion (the
+// doubling makes the square root of the encoding known, as in dalek's
+// double_and_compress_batch), constant time per point. -1 if out of memory
+int __ge_dbl_tobytes_n(uint8_t *, const ge_p3_t *, size_t);
+int __ge_is_identity(const ge_p3_t *);
+// 1 if both represent the same ristretto255 element, no encoding needed
+int __ge_eq(const ge_p3_t *, const ge_p3_t *);
+
+#endif
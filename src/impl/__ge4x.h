@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __GE4X_H__
+#define __GE4X_H__
+
+// avx2 kernel running four unrelated group operations side by side, one
+// point per 64 bit lane (radix 2^25.5 field elements, 10 limbs). used by the
+// batch paths (bulk issuance) where a single core has many independent
+// scalar multiplications to do
+
+#include "__ge25519.h"
+#include "__fbase.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// 1 if the kernel can run on this cpu
+int __ge4x_ok(void);
+
+// h[i] = a_i P for 4 consecutive 32 byte scalars, constant time
+// same contract as __fbase_smul (the tables must have a comb)
+void __ge4x_smul(ge_p3_t *, const uint8_t *, const ge_fbase_t *);
+
+#endif
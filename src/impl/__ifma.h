@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __IFMA_H__
+#define __IFMA_H__
+
+// avx512 ifma kernel for the verification equations. field elements of the
+// four coordinates (X, Y, Z, T) of a point sit in the lanes of 256 bit
+// vectors, radix 2^51 limbs fed to the 52 bit multipliers, so one point
+// addition or doubling is two 4-way multiplications (parallel hwcd formulas)
+// used automatically when the cpu has avx512ifma and avx512vl
+
+#include "__ge25519.h"
+#include "__fbase.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// 1 if the kernel can run on this cpu
+int __ifma_ok(void);
+
+// 4-way copy (+P and -P) of cnt cached points, NULL without ifma
+void *__ifma_tbl(const ge_cached_t *, size_t);
+void __ifma_tblfree(void *);
+
+// straus over precomputed wnaf digits (256 per term, starting at the given
+// top index), variable points use width MSM_PWIDTH, fixed bases their odd4
+// table (which must be set). -1 if unavailable or out of memory
+int __ifma_straus(ge_p3_t *, int,
+		const int8_t *, const ge_p3_t *, size_t,
+		const int8_t *, const ge_fbase_t *const *, size_t);
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __KCACHE_H__
+#define __KCACHE_H__
+
+// verifier side cache of K = U - xA (x = H(id, U, A)) for heng04/chin15
+// K only depends on the master public key, the identity and U, so repeat
+// authentications of the same user key skip the hash and the A term.
+// bounded, least recently used entries are evicted, thread safe.
+// every library context owns one, NULL is the cache of the process context
+
+#include "__ge25519.h"
+#include "__fbase.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define KCACHE_SLOTS 1024 //max number of cached identities
+#define KCACHE_IDLEN 32
+
+// cache key: digest of (tag, mpk fingerprint, identity, U), the tag
+// separates the schemes and their hash-to-scalar choices (K depends on both)
+#define KCACHE_TAG(scheme, hid) ((uint8_t)((scheme) | ((hid) << 4)))
+void __kcache_id(uint8_t *, uint8_t, const uint8_t *, size_t, const uint8_t *, size_t, const uint8_t *);
+
+// K = U - xA, x = H(mbuf, U, A) under the H2S_* choice. At may be NULL (A is decoded then)
+int __kcache_kgen(ge_p3_t *, const uint8_t *, const ge_fbase_t *, const uint8_t *, const uint8_t *, size_t, uint8_t);
+
+typedef struct __kcache kcache_t;
+
+kcache_t *__kcache_new(void); //NULL when out of memory
+void __kcache_free(kcache_t *);
+
+// 0 on hit (K written out), -1 on miss
+int __kcache_get(kcache_t *, const uint8_t *, ge_p3_t *);
+void __kcache_put(kcache_t *, const uint8_t *, const ge_p3_t *);
+void __kcache_clear(kcache_t *);
+// lookups since start and cached identities
+void __kcache_stats(kcache_t *, unsigned long *, unsigned long *, size_t *);
+
+#endif
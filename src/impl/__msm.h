@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __MSM_H__
+#define __MSM_H__
+
+// multi-scalar multiplication engine for the verification equations
+// sum(sc[i] * pt[i]) + bsc * B, all inputs are PUBLIC (variable time)
+
+#include "__ge25519.h"
+#include "__fbase.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// straus (interleaved wnaf) below this many terms, pippenger above
+#define MSM_PIPPENGER_MIN 190
+
+#define MSM_PWIDTH 5 //wnaf width for variable points (8 odd multiples)
+#define MSM_STACK_TERMS 5 //straus buffers on the stack up to this many terms (the protocol equations)
+#define MSM_PAR_MAX 8 //split over the helper pool (__par.h) up to this many terms
+
+// bsc is the scalar for the base point (NULL if none), sc holds n
+// consecutive reduced 32 byte scalars for the n points in pt
+int __msm_vartime(ge_p3_t *, const uint8_t *, const uint8_t *, const ge_p3_t *, size_t);
+
+// same with nf fixed bases (scalars in fsc) using their precomputed tables
+int __msm_vartime_fb(ge_p3_t *,
+		const uint8_t *, const ge_fbase_t *const *, size_t,
+		const uint8_t *, const ge_p3_t *, size_t);
+
+// single and double scalar multiplication for public data (verifier side),
+// secret scalars go through __fbase_smul/__fbase_smul2 instead
+// r = aP
+static inline int __ge_scalarmult_vartime(ge_p3_t *r, const uint8_t *a, const ge_p3_t *P){
+	return __msm_vartime(r, NULL, a, P, 1);
+}
+
+// r = aP + bB
+static inline int __ge_double_scalarmult_vartime(ge_p3_t *r,
+		const uint8_t *a, const ge_p3_t *P, const uint8_t *b){
+	return __msm_vartime(r, b, a, P, 1);
+}
+
+// odd multiples P, 3P, ..., (2cnt-1)P in cached form
+void __msm_oddtbl(ge_cached_t *, const ge_p3_t *, size_t);
+
+// received scalars are taken modulo 2^255, as libsodium's scalarmult does
+static inline void __msm_sc255(uint8_t *out, const uint8_t *in){
+	memcpy(out, in, 32);
+	out[31] &= 127;
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAR_H__
+#define __PAR_H__
+
+// small pool of pinned helper threads that take independent parts of a
+// single latency bound operation (e.g. the fixed base terms of one
+// verification equation) while the caller works on the rest. off until
+// __par_start, the caller then runs everything itself. the helpers are
+// gone in a forked child, which runs without them
+
+#include <stddef.h>
+
+typedef struct __par_job {
+	void (*fn)(void *);
+	void *arg;
+	int done;
+	struct __par_job *next;
+} par_job_t;
+
+// up to n helpers, each pinned on an allowed cpu other than the first (so
+// none on a single cpu). the previous pool is stopped first, 0 only stops
+// it. must not race with submitted jobs
+int __par_start(size_t);
+size_t __par_n(void); //running helpers
+
+// queues fn(arg) on the pool, -1 if there is none (nothing is queued)
+int __par_submit(par_job_t *, void (*)(void *), void *);
+void __par_wait(par_job_t *);
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SC25519_H__
+#define __SC25519_H__
+
+// arithmetic mod l = 2^252 + 27742317777372353535851937790883648493
+// 4x64 bit limbs, montgomery multiplication, constant time.
+// inputs are any 32 byte strings, outputs are always reduced
+
+#include <stdint.h>
+
+void __sc_reduce(uint8_t *, const uint8_t *); //64 byte input
+void __sc_add(uint8_t *, const uint8_t *, const uint8_t *);
+void __sc_sub(uint8_t *, const uint8_t *, const uint8_t *);
+void __sc_mul(uint8_t *, const uint8_t *, const uint8_t *);
+void __sc_negate(uint8_t *, const uint8_t *);
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SHA512X_H__
+#define __SHA512X_H__
+
+// multi-buffer sha512 hash-to-scalar for the batch paths
+// x_i = H(m_i || u_i || v_i) mod l, same result as __sodium_2rinhashexec.
+// runs 8 (avx512f) or 4 (avx2) independent messages per compression, one
+// at a time through libsodium on other hosts
+
+#include <stddef.h>
+#include <stdint.h>
+
+// u and v are RRE byte encodings, oarr receives n consecutive scalars
+void __sha512x_2rinhashexec(size_t,
+		const uint8_t *const *, const size_t *,
+		const uint8_t *const *, const uint8_t *const *,
+		uint8_t *);
+
+#endif
@@ -22,76 +22,92 @@
 
 // TWIN SCHNORR IBI implementation
 
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <sodium.h>
 #include "../utils/bufhelp.h"
 #include "../utils/debug.h"
 #include "__crypto.h"
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__sarena.h"
+#include "__cpool.h"
+#include "__dcq.h"
+#include "__msm.h"
+#include "__kcache.h"
 #include "ibi.h"
 #include "chin15.h"
 
+// out = n1 B + n2 B2 in constant time (secret scalars)
+static int __chin15_ctmul(uint8_t *out, const uint8_t *n1, const uint8_t *n2, const ge_fbase_t *B2t){
+	if( __fbase_init() != 0 ) return -1;
+	return __fbase_smul2(out, n1, &__fbase_B, n2, B2t);
+}
+
+// fixed bases B, B2 and (if prepared) A for the verification equations
+// returns the number of fixed bases, 0 if B2 is unusable
+static size_t __chin15_fbases(const ge_fbase_t **fb, const ge_fbase_t *B2t, const ge_fbase_t *At){
+	if( B2t == NULL ) return 0;
+	fb[0] = &__fbase_B;
+	fb[1] = B2t;
+	fb[2] = At;
+	return (At != NULL) ? 3 : 2;
+}
+
+// prover state on the secrets of usk, with a precomputed (t1, t2, T) if
+// the key has a pool that did not run dry
+static void __chin15_prvload(struct __chin15_prvst *tmp, const struct __chin15_sg *usk, uint8_t ext){
+	//copy secrets, vusk no longer needed
+	memcpy( tmp->s1, usk->s1, RRS);
+	memcpy( tmp->s2, usk->s2, RRS);
+	memcpy( tmp->U,  usk->U, RRE);
+	tmp->B2t = __fbase_acquire(usk->B2, 1); //a view holds B2 without its comb, built on first use
+	//x is not copied as it is not needed
+	tmp->pooled = (__cpool_pop(usk->cp, tmp->nonce1, tmp->nonce2, tmp->T) == 0);
+	tmp->hl = 0;
+	tmp->ext = ext;
+}
+
 void __chin15_prvstfree(void *state){
 	struct __chin15_prvst *tmp = (struct __chin15_prvst *)state; //parse state
-	sodium_free(tmp->s1);
-	sodium_free(tmp->s2);
-	sodium_free(tmp->nonce1);
-	sodium_free(tmp->nonce2);
-	memset(tmp->U, 0, RRE); //clear and free
-	free(tmp->U);
-	free(tmp->B2);
-	//free(tmp->mbuf);
-	free(tmp);
+	__fbase_release(tmp->B2t);
+	if( tmp->ext ) sodium_memzero(tmp, sizeof(struct __chin15_prvst));
+	else __sarena_free(tmp); //zeroes the secrets, nonces and U
 }
 
 void __chin15_verstfree(void *state){
 	struct __chin15_verst *tmp = (struct __chin15_verst *)state; //parse state
-	free(tmp->A);
-	free(tmp->B2);
-	free(tmp->c);
-	free(tmp->U);
-	free(tmp->NE);
-	free(tmp->mbuf);
-	free(tmp);
+	__fbase_release(tmp->B2t);
+	__fbase_release(tmp->At);
+	if( !tmp->ext ) free(tmp);
 }
 
 //mbuf and mlen unused
 void __chin15_prvinit(void *vusk, const uint8_t *mbuf, size_t mlen, void **state){
-	struct __chin15_sg *usk = (struct __chin15_sg *)vusk;
 	struct __chin15_prvst *tmp;
-	tmp = (struct __chin15_prvst *)malloc(sizeof(struct __chin15_prvst));
-
-	//allocate and copy for mbuf (mbuf not needed on prover side actually)
-	//tmp->mbuf = (uint8_t *)malloc(mlen);
-	//tmp->mlen = mlen;
-	//memcpy(tmp->mbuf, mbuf, mlen);
-
-	//copy secrets, vusk no longer needed
-	tmp->s1 = (uint8_t *)sodium_malloc(RRS);
-	tmp->s2 = (uint8_t *)sodium_malloc(RRS);
-	tmp->U  = (uint8_t *)malloc(RRE);
-	tmp->B2 = (uint8_t *)malloc(RRE);
-	memcpy( tmp->s1, usk->s1, RRS);
-	memcpy( tmp->s2, usk->s2, RRS);
-	memcpy( tmp->U,  usk->U, RRE);
-	memcpy( tmp->B2, usk->B2, RRE); //x is not copied as it is not needed
-
+	tmp = (struct __chin15_prvst *)__sarena_alloc(sizeof(struct __chin15_prvst));
+	__chin15_prvload(tmp, (struct __chin15_sg *)vusk, 0);
 	*state = (void *)tmp; //recast and return
 }
 
+void __chin15_prvinit_at(void *vusk, const uint8_t *mbuf, size_t mlen, void *state){
+	__chin15_prvload((struct __chin15_prvst *)state, (struct __chin15_sg *)vusk, 1);
+}
+
 //mbuf and mlen unused in this case, but generally it could be used
 void __chin15_cmtgen(void **state, uint8_t *cmt){
 	struct __chin15_prvst *tmp = (struct __chin15_prvst *)(*state); //parse state
 
-	uint8_t tbuf[RRE]; int rc;
-	tmp->nonce1 = (uint8_t *)sodium_malloc(RRS);
-	tmp->nonce2 = (uint8_t *)sodium_malloc(RRS); //allocate nonce
-	crypto_core_ristretto255_scalar_random(tmp->nonce1);
-	crypto_core_ristretto255_scalar_random(tmp->nonce2); //sample nonce and compute cmt
-
-	rc = crypto_scalarmult_ristretto255_base(tbuf, tmp->nonce1);
-	rc += crypto_scalarmult_ristretto255(cmt, tmp->nonce2, tmp->B2);
-	rc += crypto_core_ristretto255_add(cmt+RRE, tbuf, cmt);// tbuf @ RRE after cmt
+	int rc;
+	if( tmp->pooled ){
+		memcpy(cmt+RRE, tmp->T, RRE); //nonces came from the pool
+	}else{
+		__cb->scrand(tmp->nonce1);
+		__cb->scrand(tmp->nonce2); //sample nonce and compute cmt
+		rc = __chin15_ctmul(cmt+RRE, tmp->nonce1, tmp->nonce2, tmp->B2t); // T @ RRE after U
+		if( rc != 0 ) memset(cmt+RRE, 0, RRE); //no comb for B2 (out of memory), the session fails
+	}
 
 	copyskip(cmt, tmp->U, 0, RRE); //send U first
 	*state = (void *)tmp; //recast and return
@@ -100,101 +116,246 @@ void __chin15_cmtgen(void **state, uint8_t *cmt){
 void __chin15_resgen(const uint8_t *cha, void *state, uint8_t *res){
 	struct __chin15_prvst *tmp = (struct __chin15_prvst *)state; //parse state
 	//y1 = t1 + c s1
-	crypto_core_ristretto255_scalar_mul( res, cha, tmp->s1 );
-	crypto_core_ristretto255_scalar_add( res, res, tmp->nonce1 );
+	__cb->scmul( res, cha, tmp->s1 );
+	__cb->scadd( res, res, tmp->nonce1 );
 	//y2 = t2 + c s2
-	crypto_core_ristretto255_scalar_mul( res+RRE, cha, tmp->s2 );
-	crypto_core_ristretto255_scalar_add( res+RRE, res+RRE, tmp->nonce2 );
+	__cb->scmul( res+RRE, cha, tmp->s2 );
+	__cb->scadd( res+RRE, res+RRE, tmp->nonce2 );
 	__chin15_prvstfree(state); //critical, PLEASE FREE BEFORE RETURNING
 }
 
-void __chin15_verinit(void *vpar, const uint8_t *mbuf, size_t mlen, void **state){
-	struct __chin15_pk *par = (struct __chin15_pk *)vpar; //parse mpk
-	struct __chin15_verst *tmp;
-	//allocate
-	tmp = (struct __chin15_verst *)malloc(sizeof(struct __chin15_verst));
+void __chin15s_resgen(const uint8_t *cha, void *state, uint8_t *res){
+	uint8_t c[RRS] = {0};
+	memcpy(c, cha, CHIN15S_CHALEN);
+	__chin15_resgen(c, state, res);
+}
 
-	//copy mbuf
-	tmp->mbuf = (uint8_t *)malloc(mlen);
-	memcpy(tmp->mbuf, mbuf, mlen);
+// the challenge is independent of the commitment, so it is sampled here
+static void __chin15_verload(struct __chin15_verst *tmp, kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, size_t clen){
+	struct __chin15_pk *par = (struct __chin15_pk *)vpar; //parse mpk
+	tmp->kc = kc;
+	tmp->m = mbuf;
 	tmp->mlen = mlen;
 
 	//copy public params
-	tmp->A = (uint8_t *)malloc(RRE);
-	tmp->B2 = (uint8_t *)malloc(RRE);
 	memcpy(tmp->A,  par->A, RRE);
-	memcpy(tmp->B2, par->B2, RRE);
+	tmp->B2t = __fbase_dup(par->B2t);
+	tmp->At = __fbase_dup(par->At);
+	tmp->hid = par->hid;
+	tmp->hl = 0;
+	tmp->pre = 0;
 
+	//generate challenge
+	memset(tmp->c, 0, RRS);
+	if( clen == RRS ) __cb->scrand(tmp->c);
+	else __cb->randbytes(tmp->c, clen); //short challenge, zero extended
+}
+
+static void __chin15_verinit_l(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void **state, size_t clen){
+	struct __chin15_verst *tmp;
+	//allocate with room for mbuf
+	tmp = (struct __chin15_verst *)malloc(sizeof(struct __chin15_verst) + mlen);
+	memcpy(tmp->mbuf, mbuf, mlen);
+	__chin15_verload(tmp, kc, vpar, tmp->mbuf, mlen, clen);
+	tmp->ext = 0;
 	*state = (void *)tmp; //recast and return
 }
 
+void __chin15_verinit(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void **state){
+	__chin15_verinit_l(kc, vpar, mbuf, mlen, state, CHIN15_CHALEN);
+}
+
+void __chin15s_verinit(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void **state){
+	__chin15_verinit_l(kc, vpar, mbuf, mlen, state, CHIN15S_CHALEN);
+}
+
+//caller storage, mbuf is not copied and must outlive the session
+void __chin15_verinit_at(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void *state){
+	__chin15_verload((struct __chin15_verst *)state, kc, vpar, mbuf, mlen, CHIN15_CHALEN);
+	((struct __chin15_verst *)state)->ext = 1;
+}
+
+void __chin15s_verinit_at(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void *state){
+	__chin15_verload((struct __chin15_verst *)state, kc, vpar, mbuf, mlen, CHIN15S_CHALEN);
+	((struct __chin15_verst *)state)->ext = 1;
+}
+
 //vpar unused, but generally it MAY be used
-void __chin15_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
+static void __chin15_chagen_l(const uint8_t *cmt, void **state, uint8_t *cha, size_t clen){
 	struct __chin15_verst *tmp = (struct __chin15_verst *)(*state); //parse state
 
-	tmp->U = (uint8_t *)malloc(RRE);
-	tmp->NE = (uint8_t *)malloc(RRE);
-
 	//parse commit
+	//commit = U', V = vB where v is nonce
 	skipcopy( tmp->U,  cmt, 0, 	RRE);
 	skipcopy( tmp->NE, cmt, RRE, 	RRE);
 
-	//generate challenge
-	//commit = U', V = vB where v is nonce
-	tmp->c = (uint8_t *)malloc(RRS);
 	//*cha = (uint8_t *)malloc(CHIN15_CHALEN); //leave it up to user to allocate
-	crypto_core_ristretto255_scalar_random(tmp->c);
-	memcpy(cha, tmp->c, RRS);
+	memcpy(cha, tmp->c, clen); //sampled by verinit
 
 	*state = (void *)tmp; //recast and return
 }
 
-//main decision function for protocol
-void __chin15_protdc(const uint8_t *res, void *state, int *dec){
+void __chin15_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
+	__chin15_chagen_l(cmt, state, cha, CHIN15_CHALEN);
+}
+
+void __chin15s_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
+	__chin15_chagen_l(cmt, state, cha, CHIN15S_CHALEN);
+}
+
+// K = U' - xA through the key cache, hit is set if it was cached
+static int __chin15_kget(struct __chin15_verst *tmp, ge_p3_t *K, int *hit){
+	uint8_t mpk[2*RRE];
+	memcpy(mpk, tmp->A, RRE);
+	memcpy(mpk+RRE, tmp->B2t->enc, RRE);
+	__kcache_id(tmp->kid, KCACHE_TAG(1, tmp->hid), mpk, 2*RRE, tmp->m, tmp->mlen, tmp->U);
+	*hit = (__kcache_get(tmp->kc, tmp->kid, K) == 0);
+	return *hit ? 0 : __kcache_kgen(K, tmp->A, tmp->At, tmp->U, tmp->m, tmp->mlen, tmp->hid);
+}
+
+// response independent part of protdc, to run after chagen while the
+// challenge and response are in flight. leaves protdc with
+// y1B + y2B2 == T + cK
+void __chin15_verpre(void *state){
+	struct __chin15_verst *tmp = (struct __chin15_verst *)(state); //parse state
+	ge_p3_t T, cK;
+	int hit = 0, rc;
+
+	if( tmp->pre != 0 ) return; //already done
+	rc = (tmp->B2t == NULL) ? -1 : __chin15_kget(tmp, &tmp->K, &hit);
+	if( rc == 0 ) rc = __ge_frombytes(&T, tmp->NE);
+	if( rc == 0 ) rc = __ge_scalarmult_vartime(&cK, tmp->c, &tmp->K);
+	if( rc == 0 ) __ge_p3_add(&tmp->Q, &T, &cK);
+	tmp->pre = (rc != 0) ? -1 : (hit ? 2 : 1);
+}
+
+// decision after verpre, the y are split over B, B2 and their 2^128
+// multiples so that the fixed base lookups run on half length scalars
+static void __chin15_protdc_pre(const uint8_t *res, struct __chin15_verst *tmp, int *dec){
+	uint8_t y[RRS], fsc[4*RRS] = {0};
+	const ge_fbase_t *fb[4];
+	ge_p3_t r;
+
+	*dec = (tmp->pre < 0) ? -1 : 0;
+	if( *dec == 0 ){
+		__chin15_fbases(fb, tmp->B2t, NULL);
+		fb[2] = __fbase_hi(&__fbase_B);
+		fb[3] = __fbase_hi(tmp->B2t);
+		for(int j=0;j<2;j++){
+			__msm_sc255(y, res + RRS*j);
+			memcpy(fsc + RRS*j, y, 16);
+			memcpy(fsc + RRS*(j+2), y + 16, 16);
+		}
+		*dec = (fb[2] == NULL || fb[3] == NULL) ? -1 :
+			__msm_vartime_fb(&r, fsc, fb, 4, NULL, NULL, 0);
+		if( *dec == 0 && !__ge_eq(&r, &tmp->Q) ) *dec = -1;
+	}
+	if( *dec == 0 && tmp->pre == 1 ) __kcache_put(tmp->kc, tmp->kid, &tmp->K);
+}
+
+//main decision function for protocol, clen is the challenge length
+static void __chin15_protdc_l(const uint8_t *res, void *state, int *dec, size_t clen){
 	struct __chin15_verst *tmp = (struct __chin15_verst *)(state); //parse state
 
-	uint8_t rhs[RRE], lhs[RRE], tbuf[RRS], xp[RRS];
-	__sodium_2rinhashexec(tmp->mbuf, tmp->mlen, tmp->U, tmp->A, xp);
+	uint8_t fsc[4*RRS] = {0}, y[2*RRS], nc[RRS];
+	const ge_fbase_t *fb[4];
+	ge_p3_t K, nK, T, r;
+	int hit = 0;
 
-	// yB = T + c( U' - xP1 )
-	*dec = crypto_scalarmult_ristretto255_base( lhs, res); //y1B1
-	*dec += crypto_scalarmult_ristretto255( tbuf, res+RRS, tmp->B2); //y2B2
-	*dec += crypto_core_ristretto255_add( lhs, lhs, tbuf); // lhs :y1B1 + y2B2
+	if( tmp->pre != 0 ){
+		__chin15_protdc_pre(res, tmp, dec);
+		__chin15_verstfree(state);
+		return;
+	}
 
-	*dec += crypto_scalarmult_ristretto255( rhs, xp, tmp->A); // xA
-	*dec += crypto_core_ristretto255_sub( rhs, tmp->U, rhs); // U' - xA
-	*dec += crypto_scalarmult_ristretto255(rhs, tmp->c, rhs); // c(U' - xA)
-	*dec += crypto_core_ristretto255_add(rhs, tmp->NE, rhs);// T + c(U' - xA)
+	// y1B + y2B2 = T + c( U' - xA ) = T + cK, K only depends on (mpk, id, U')
+	*dec = (__chin15_fbases(fb, tmp->B2t, NULL) == 0) ? -1 : 0;
+	if( *dec == 0 ) *dec = __chin15_kget(tmp, &K, &hit);
+	__msm_sc255(y, res); // y1
+	__msm_sc255(y+RRS, res+RRS); // y2
+	if( *dec == 0 && clen == RRS ){
+		__cb->scneg(nc, tmp->c); // -c
+		*dec = __msm_vartime_fb(&r, y, fb, 2, nc, &K, 1);
+	}else if( *dec == 0 ){
+		// c < 2^128, the y are split over B, B2 and their 2^128 multiples
+		// and -K is taken with c itself, every scalar is half length
+		fb[2] = __fbase_hi(&__fbase_B);
+		fb[3] = __fbase_hi(tmp->B2t);
+		for(int j=0;j<2;j++){
+			memcpy(fsc + RRS*j, y + RRS*j, 16);
+			memcpy(fsc + RRS*(j+2), y + RRS*j + 16, 16);
+		}
+		__ge_p3_neg(&nK, &K);
+		*dec = (fb[2] == NULL || fb[3] == NULL) ? -1 :
+			__msm_vartime_fb(&r, fsc, fb, 4, tmp->c, &nK, 1);
+	}
+	if( *dec == 0 ){
+		*dec += __ge_frombytes(&T, tmp->NE);
+		if( *dec == 0 && !__ge_eq(&r, &T) ) *dec = -1; //compare unencoded
+	}
+	if( *dec == 0 && !hit ) __kcache_put(tmp->kc, tmp->kid, &K); //only cache keys that verified
 
 	__chin15_verstfree(state);
-	*dec += crypto_verify_32(lhs, rhs);
+}
+
+void __chin15_protdc(const uint8_t *res, void *state, int *dec){
+	__chin15_protdc_l(res, state, dec, CHIN15_CHALEN);
+}
+
+void __chin15s_protdc(const uint8_t *res, void *state, int *dec){
+	__chin15_protdc_l(res, state, dec, CHIN15S_CHALEN);
+}
+
+// y1B + y2B2 = T + c(U' - xA) in deferred decision form, frees the state as protdc
+int __chin15_dcprep(const uint8_t *res, void *state, struct __ibi_dcent *e){
+	struct __chin15_verst *tmp = (struct __chin15_verst *)(state); //parse state
+	uint8_t x[RRS];
+	int rc;
+
+	rc = (tmp->B2t == NULL) ? -1 : 0;
+	rc += __ge_frombytes(&e->U, tmp->U);
+	rc += __ge_frombytes(&e->T, tmp->NE);
+	if( tmp->At != NULL ) e->A = tmp->At->P;
+	else rc += __ge_frombytes(&e->A, tmp->A);
+	if( rc == 0 ){
+		__h2s(tmp->hid, tmp->m, tmp->mlen, tmp->U, tmp->A, x);
+		memcpy(e->c, tmp->c, RRS); //short challenges are zero extended
+		__cb->scmul(e->cx, tmp->c, x);
+		__msm_sc255(e->y1, res);
+		__msm_sc255(e->y2, res+RRS);
+		memcpy(e->Ab, tmp->A, RRE);
+		e->At = __fbase_dup(tmp->At);
+		e->B2t = __fbase_dup(tmp->B2t);
+	}
+
+	__chin15_verstfree(state);
+	return (rc == 0) ? 0 : -1;
 }
 
 // memory allocation
 struct __chin15_pk *__chin15_pkinit(void){
 	struct __chin15_pk *out;
 	out = (struct __chin15_pk *)malloc( sizeof(struct __chin15_pk) );
-	out->A = (uint8_t *)malloc( RRE );
-	out->B2 = (uint8_t *)malloc( RRE );
+	out->B2t = NULL;
+	out->At = NULL;
+	out->hid = H2S_SHA512;
+	out->ext = 0;
 	return out;
 }
 struct __chin15_sk *__chin15_skinit(void){
 	struct __chin15_sk *out;
-	out = (struct __chin15_sk *)malloc( sizeof(struct __chin15_sk) );
+	out = (struct __chin15_sk *)__sarena_alloc( sizeof(struct __chin15_sk) );
 	out->hf = 0; //non hierarchical signature (this is a key)
-	out->a1 = (uint8_t *)sodium_malloc( RRS );
-	out->a2 = (uint8_t *)sodium_malloc( RRS );
 	out->pub = __chin15_pkinit();
 	return out;
 }
 struct __chin15_sg *__chin15_sginit(void){
 	struct __chin15_sg *out;
-	out = (struct __chin15_sg *)malloc( sizeof( struct __chin15_sg) );
-	out->s1 = (uint8_t *)sodium_malloc( RRS );
-	out->s2 = (uint8_t *)sodium_malloc( RRS );
-	out->x = (uint8_t *)malloc( RRS );
-	out->U = (uint8_t *)malloc( RRE );
-	out->B2 = (uint8_t *)malloc( RRE );
+	out = (struct __chin15_sg *)__sarena_alloc( sizeof( struct __chin15_sg) );
+	out->B2t = NULL;
+	out->cp = NULL;
+	out->hid = H2S_SHA512;
+	out->ext = 0;
 	return out;
 }
 
@@ -203,59 +364,46 @@ void __chin15_pkfree(void *in){
 	//key recast
 	struct __chin15_pk *ri = (struct __chin15_pk *)in;
 	//free up memory
-	free(ri->A);
-	free(ri->B2);
-	free(ri);
+	__fbase_release(ri->B2t);
+	__fbase_release(ri->At);
+	if( !ri->ext ) free(ri);
 }
 void __chin15_skfree(void *in){
 	//key recast
 	struct __chin15_sk *ri = (struct __chin15_sk *)in;
-	//zero out the secret component
-	//sodium_memzero(ri->a1, RRS);
-	//sodium_memzero(ri->a2, RRS);
-
-	//free memory
-	sodium_free(ri->a1);
-	sodium_free(ri->a2);
+	//free memory, __sarena_free zeroes the secrets
 	__chin15_pkfree(ri->pub);
-	free(ri);
+	__sarena_free(ri);
 }
 void __chin15_sgfree(void *in){
 	//key recast
 	struct __chin15_sg *ri = (struct __chin15_sg *)in;
-	//clear the components
-	//sodium_memzero(ri->s, RRS); //sodium_free already does this
-	//sodium_memzero(ri->x, RRS);
-	//sodium_memzero(ri->U, RRE);
-	//free memory
-	sodium_free(ri->s1);
-	sodium_free(ri->s2);
-	free(ri->x);
-	//free(ri->x);
-	free(ri->U);
-	free(ri->B2);
-	free(ri);
+	//free memory, __sarena_free zeroes the components
+	__fbase_release(ri->B2t);
+	__cpool_free(ri->cp);
+	if( ri->ext ) sodium_memzero(ri, sizeof(struct __chin15_sg));
+	else __sarena_free(ri);
 }
 
 void __chin15_skgen(void **out){
 	int rc;
 	//declare and allocate memory for key
 	struct __chin15_sk *tmp = __chin15_skinit();
-	uint8_t neg[RRS], tbuf[RRE];
+	uint8_t neg1[RRS], neg2[RRS];
 
 	//sample secret a
-	crypto_core_ristretto255_random( tmp->pub->B2 );
-	crypto_core_ristretto255_scalar_random( tmp->a1 );
-	crypto_core_ristretto255_scalar_random( tmp->a2 );
-
-	crypto_core_ristretto255_scalar_negate(neg , tmp->a1);
-	rc = crypto_scalarmult_ristretto255_base(tbuf, neg);
-	crypto_core_ristretto255_scalar_negate(neg , tmp->a2);
-	rc += crypto_scalarmult_ristretto255(tmp->pub->A, neg, tmp->pub->B2);
-	rc += crypto_core_ristretto255_add(tmp->pub->A, tbuf, tmp->pub->A);
-
-	memset(tbuf, 0, RRE); // zero memory
-	memset(neg, 0, RRS); // zero memory
+	__cb->ptrand( tmp->pub->B2 );
+	tmp->pub->B2t = __fbase_acquire( tmp->pub->B2, 1 );
+	__cb->scrand( tmp->a1 );
+	__cb->scrand( tmp->a2 );
+
+	// A = -a1B - a2B2
+	__cb->scneg(neg1, tmp->a1);
+	__cb->scneg(neg2, tmp->a2);
+	rc = __chin15_ctmul(tmp->pub->A, neg1, neg2, tmp->pub->B2t);
+
+	memset(neg1, 0, RRS); // zero memory
+	memset(neg2, 0, RRS); // zero memory
 	assert(rc == 0);
 
 	//recast and return
@@ -270,9 +418,19 @@ void __chin15_pkext(void *vkey, void **out){
 	size_t rs;
 	memcpy(tmp->A, key->pub->A, RRE);
 	memcpy(tmp->B2, key->pub->B2, RRE);
+	tmp->B2t = __fbase_dup(key->pub->B2t);
+	tmp->At = __fbase_dup(key->pub->At);
+	tmp->hid = key->pub->hid;
 	*out = (void *)tmp;
 }
 
+// decode A once and keep its tables for the verifiers
+int __chin15_pkprep(void *in){
+	struct __chin15_pk *ri = (struct __chin15_pk *)in;
+	if( ri->At == NULL ) ri->At = __fbase_acquire(ri->A, 0);
+	return (ri->At == NULL || ri->B2t == NULL) ? -1 : 0;
+}
+
 void __chin15_siggen(
 	void *vkey,
 	const uint8_t *mbuf, size_t mlen,
@@ -289,26 +447,25 @@ void __chin15_siggen(
 	uint8_t nonce1[RRS], nonce2[RRS];
 
 	//sample r (MUST RANDOMIZE, else secret key a will be exposed)
-	crypto_core_ristretto255_scalar_random(nonce1);
-	crypto_core_ristretto255_scalar_random(nonce2);
+	__cb->scrand(nonce1);
+	__cb->scrand(nonce2);
 
-	rc = crypto_scalarmult_ristretto255_base( tmp->U, nonce1); // nP
-	rc += crypto_scalarmult_ristretto255(tmp->B2, nonce2, key->pub->B2); // n2P2
-
-	rc += crypto_core_ristretto255_add(tmp->U, tmp->U, tmp->B2);
-	__sodium_2rinhashexec(mbuf, mlen, tmp->U, key->pub->A, tmp->x);
+	rc = __chin15_ctmul(tmp->U, nonce1, nonce2, key->pub->B2t); // n1P + n2P2
+	__h2s(key->pub->hid, mbuf, mlen, tmp->U, key->pub->A, tmp->x);
 
 	// s1 = r1 + xa1
-	crypto_core_ristretto255_scalar_mul( tmp->s1 , tmp->x, key->a1 );
-	crypto_core_ristretto255_scalar_add( tmp->s1, tmp->s1, nonce1 );
+	__cb->scmul( tmp->s1 , tmp->x, key->a1 );
+	__cb->scadd( tmp->s1, tmp->s1, nonce1 );
 
 	// s2 = r2 + xa2
-	crypto_core_ristretto255_scalar_mul( tmp->s2 , tmp->x, key->a2 );
-	crypto_core_ristretto255_scalar_add( tmp->s2, tmp->s2, nonce2 );
+	__cb->scmul( tmp->s2 , tmp->x, key->a2 );
+	__cb->scadd( tmp->s2, tmp->s2, nonce2 );
 	assert(rc == 0);
 
 	//store B2 on the signature
 	memcpy( tmp->B2, key->pub->B2, RRE );
+	tmp->B2t = __fbase_dup(key->pub->B2t);
+	tmp->hid = key->pub->hid;
 
 	//ensure zero
 	memset( nonce1, 0, RRS);
@@ -317,6 +474,62 @@ void __chin15_siggen(
 	*out = (void *) tmp;
 }
 
+// U = n1 B + n2 B2 for every signature in one pass, four nonces per step
+// and one inversion for all the encodings
+void __chin15_siggen_batch(
+	void *vkey,
+	const uint8_t **mbufs, const size_t *mlens,
+	size_t n, void **out
+){
+	struct __chin15_sk *key = (struct __chin15_sk *)vkey;
+	uint8_t *nonce = (uint8_t *)sodium_malloc( 2*n*RRS );
+	uint8_t *U = (uint8_t *)malloc( n*RRE );
+	uint8_t *xs = (uint8_t *)malloc( n*RRS );
+	const uint8_t **ub = (const uint8_t **)malloc( 2*n*sizeof(uint8_t *) );
+	const uint8_t **vb;
+	struct __chin15_sg *tmp;
+
+	if( nonce != NULL ){
+		for(size_t i=0;i<2*n;i++) __cb->scrand(nonce + i*RRS);
+	}
+	//one at a time when out of memory or without the tables
+	if( nonce == NULL || U == NULL || xs == NULL || ub == NULL ||
+			key->pub->B2t == NULL || __fbase_init() != 0 ||
+			__fbase_smul2_n(U, nonce, &__fbase_B, nonce + n*RRS, key->pub->B2t, n) != 0 ){
+		for(size_t i=0;i<n;i++) __chin15_siggen(vkey, mbufs[i], mlens[i], &out[i]);
+		sodium_free(nonce);
+		free(U); free(xs); free(ub);
+		return;
+	}
+	vb = ub + n;
+
+	for(size_t i=0;i<n;i++){
+		ub[i] = U + i*RRE;
+		vb[i] = key->pub->A;
+	}
+	__h2s_n(key->pub->hid, n, mbufs, mlens, ub, vb, xs);
+
+	for(size_t i=0;i<n;i++){
+		tmp = __chin15_sginit();
+		memcpy(tmp->U, U + i*RRE, RRE);
+		memcpy(tmp->x, xs + i*RRS, RRS);
+		// s1 = r1 + xa1, s2 = r2 + xa2
+		__cb->scmul( tmp->s1, tmp->x, key->a1 );
+		__cb->scadd( tmp->s1, tmp->s1, nonce + i*RRS );
+		__cb->scmul( tmp->s2, tmp->x, key->a2 );
+		__cb->scadd( tmp->s2, tmp->s2, nonce + (n+i)*RRS );
+		memcpy( tmp->B2, key->pub->B2, RRE );
+		tmp->B2t = __fbase_dup(key->pub->B2t);
+		tmp->hid = key->pub->hid;
+		out[i] = (void *)tmp;
+	}
+
+	sodium_free(nonce);
+	free(U);
+	free(xs);
+	free(ub);
+}
+
 void __chin15_sigvrf(
 	void *vpar,
 	void *vsig,
@@ -328,19 +541,149 @@ void __chin15_sigvrf(
 	struct __chin15_sg *sig = (struct __chin15_sg *)vsig;
 
 	//tmp arrays
-	uint8_t xp[RRS], tmp1[RRE], tmp2[RRE];
+	uint8_t xp[RRS], tmp1[RRE], sc[3*RRS];
+	const ge_fbase_t *fb[3];
+	const size_t nf = __chin15_fbases(fb, par->B2t, par->At);
+	ge_p3_t A, r;
+
+	// U' = s1B + s2B2 + xA, B2 is the one from the public key
+	*res = (nf == 0) ? -1 : 0;
+	if( nf == 2 ) *res += __ge_frombytes(&A, par->A);
+	if( *res != 0 ) return;
+	__msm_sc255(sc, sig->s1);
+	__msm_sc255(sc+RRS, sig->s2);
+	__msm_sc255(sc+2*RRS, sig->x);
+	*res = __msm_vartime_fb(&r, sc, fb, nf, sc + nf*RRS, &A, 3 - nf);
+	__ge_tobytes(tmp1, &r);
+
+	__h2s(par->hid, mbuf, mlen, tmp1, par->A, xp);
+	//check if hash is equal to x from vsig
+	*res += crypto_verify_32( xp, sig->x );
+}
+
+// decoded batch entry
+struct __chin15_bent {
+	ge_p3_t A, U;
+	const uint8_t *Ab; //encoded A, entries on the same key share the term
+	const ge_fbase_t *B2t; //shared tables, equal B2 means equal pointer
+	const ge_fbase_t *At; //tables of A if the key was prepared
+	const uint8_t *x;
+	uint8_t s1[RRS], s2[RRS];
+};
 
-	// U' = sB - A
-	*res = crypto_scalarmult_ristretto255_base(tmp1, sig->s1); //s1B
-	*res += crypto_scalarmult_ristretto255(tmp2, sig->s2, sig->B2); // s2B2
-	*res += crypto_core_ristretto255_add(tmp1, tmp1, tmp2); // (s1B + s2B2)
+// sum z_i( s1_i B + s2_i B2_i + x_i A_i - U_i ) == 0 for random 128bit z_i
+int __chin15_bchk(void *ctx, const size_t *idx, size_t n){
+	struct __chin15_bent *ent = (struct __chin15_bent *)ctx;
+	uint8_t *sc = (uint8_t *)calloc( 2*n, RRS );
+	uint8_t *fsc = (uint8_t *)calloc( n+2, RRS );
+	ge_p3_t *pt = (ge_p3_t *)malloc( 2*n*sizeof(ge_p3_t) );
+	const ge_fbase_t **fb = (const ge_fbase_t **)malloc( (n+2)*sizeof(ge_fbase_t *) );
+	uint8_t z[RRS], t[RRS]; ge_p3_t r;
+	size_t c = 1, nf = 1, k; int rc;
+
+	if( sc == NULL || fsc == NULL || pt == NULL || fb == NULL ){
+		free(sc); free(fsc); free(pt); free(fb);
+		return -1; //out of memory, the group fails
+	}
 
-	*res += crypto_scalarmult_ristretto255(tmp2, sig->x, par->A); // xA
-	*res += crypto_core_ristretto255_add(tmp1, tmp1, tmp2); // U' = (s1B+s2B2)-xA
+	// fixed bases: B then every distinct B2, term 0: A of the first entry
+	fb[0] = &__fbase_B;
+	pt[0] = ent[idx[0]].A;
+	memset(z, 0, RRS);
+	for(size_t i=0;i<n;i++){
+		struct __chin15_bent *e = &ent[idx[i]];
+		__cb->randbytes(z, 16);
+		__cb->scmul(t, z, e->s1);
+		__cb->scadd(fsc, fsc, t);
+		for(k=1;k<nf && fb[k] != e->B2t;k++);
+		if( k == nf ) fb[nf++] = e->B2t;
+		__cb->scmul(t, z, e->s2);
+		__cb->scadd(fsc + k*RRS, fsc + k*RRS, t);
+		if( memcmp(e->Ab, ent[idx[0]].Ab, RRE) == 0 ){
+			__cb->scmul(t, z, e->x);
+			__cb->scadd(sc, sc, t);
+		}else{
+			__cb->scmul(sc + c*RRS, z, e->x);
+			pt[c++] = e->A;
+		}
+		__cb->scneg(sc + c*RRS, z);
+		pt[c++] = e->U;
+	}
 
-	__sodium_2rinhashexec(mbuf, mlen, tmp1, par->A, xp);
-	//check if hash is equal to x from vsig
-	*res += crypto_verify_32( xp, sig->x );
+	// a prepared first key moves term 0 to the fixed bases
+	if( ent[idx[0]].At != NULL ){
+		memcpy(fsc + nf*RRS, sc, RRS);
+		fb[nf++] = ent[idx[0]].At;
+		rc = __msm_vartime_fb(&r, fsc, fb, nf, sc+RRS, pt+1, c-1);
+	}else{
+		rc = __msm_vartime_fb(&r, fsc, fb, nf, sc, pt, c);
+	}
+	if( rc == 0 && !__ge_is_identity(&r) ) rc = -1;
+	free(sc);
+	free(fsc);
+	free(pt);
+	free(fb);
+	return rc;
+}
+
+// B2 is taken from the public key, signatures carrying another B2 are rejected
+void __chin15_sigvrf_batch(
+	void **vpars,
+	void **vsigs,
+	const uint8_t **mbufs, const size_t *mlens,
+	size_t n, int *res
+){
+	struct __chin15_bent *ent;
+	size_t *idx, c = 0;
+	uint8_t *xp;
+	const uint8_t **ub, **vb;
+
+	ent = (struct __chin15_bent *)malloc( n*sizeof(struct __chin15_bent) );
+	idx = (size_t *)malloc( n*sizeof(size_t) );
+	xp = (uint8_t *)malloc( n*RRS );
+	ub = (const uint8_t **)malloc( 2*n*sizeof(uint8_t *) );
+	if( ent == NULL || idx == NULL || xp == NULL || ub == NULL ){
+		for(size_t i=0;i<n;i++) res[i] = -1; //out of memory, nothing verified
+		free(ent); free(idx); free(xp); free(ub);
+		return;
+	}
+	vb = ub + n;
+
+	// x = H(m, U, A) for every entry, several lanes at once
+	// (batches are grouped by algorithm, the keys share one hash)
+	for(size_t i=0;i<n;i++){
+		ub[i] = ((struct __chin15_sg *)vsigs[i])->U;
+		vb[i] = ((struct __chin15_pk *)vpars[i])->A;
+	}
+	if( n > 0 ) __h2s_n(((struct __chin15_pk *)vpars[0])->hid, n, mbufs, mlens, ub, vb, xp);
+
+	for(size_t i=0;i<n;i++){
+		struct __chin15_pk *par = (struct __chin15_pk *)vpars[i];
+		struct __chin15_sg *sig = (struct __chin15_sg *)vsigs[i];
+		res[i] = -1;
+		if( par->B2t == NULL ) continue;
+		if( crypto_verify_32( par->B2, sig->B2 ) != 0 ) continue;
+		if( crypto_verify_32( xp + i*RRS, sig->x ) != 0 ) continue;
+		if( par->At != NULL ){
+			ent[i].A = par->At->P;
+		}else if( __ge_frombytes(&ent[i].A, par->A) != 0 ){
+			continue;
+		}
+		if( __ge_frombytes(&ent[i].U, sig->U) != 0 ) continue;
+		ent[i].Ab = par->A;
+		ent[i].B2t = par->B2t;
+		ent[i].At = par->At;
+		__msm_sc255(ent[i].s1, sig->s1);
+		__msm_sc255(ent[i].s2, sig->s2);
+		ent[i].x = sig->x;
+		idx[c++] = i;
+	}
+
+	__ds_bisect((void *)ent, __chin15_bchk, idx, c, res);
+	free(ent);
+	free(idx);
+	free(xp);
+	free(ub);
 }
 
 //debugging use only
@@ -400,6 +743,7 @@ size_t __chin15_pkconstr(const uint8_t *in, void **out){
 	struct __chin15_pk *tmp = __chin15_pkinit();
 	rs = skipcopy( tmp->A,		in, 0, 	RRE);
 	rs = skipcopy( tmp->B2,		in, rs, RRE);
+	tmp->B2t = __fbase_acquire(tmp->B2, 0);
 	*out = (void *) tmp;
 	return rs;
 }
@@ -411,6 +755,7 @@ size_t __chin15_skconstr(const uint8_t *in, void **out){
 	rs = skipcopy( tmp->a2,		in, rs,	RRS);
 	rs = skipcopy( tmp->pub->A,	in, rs, RRE);
 	rs = skipcopy( tmp->pub->B2,	in, rs, RRE);
+	tmp->pub->B2t = __fbase_acquire(tmp->pub->B2, 1);
 	*out = (void *) tmp;
 	return rs;
 }
@@ -423,16 +768,57 @@ size_t __chin15_sgconstr(const uint8_t *in, void **out){
 	rs = skipcopy( tmp->x,		in, rs, RRS);
 	rs = skipcopy( tmp->U,		in, rs, RRE);
 	rs = skipcopy( tmp->B2,		in, rs, RRE);
+	tmp->B2t = __fbase_acquire(tmp->B2, 1);
+	if( tmp->B2t == NULL ){
+		//B2 does not decode, the key cannot prove
+		__chin15_sgfree(tmp);
+		*out = NULL;
+		return 0;
+	}
 	*out = (void *) tmp;
 	return rs;
 }
 
+// views, parsed into caller storage of CHIN15_VLEN bytes
+size_t __chin15_pkview(const uint8_t *in, size_t len, void *out){
+	size_t rs;
+	struct __chin15_pk *tmp = (struct __chin15_pk *)out;
+	if( len < CHIN15_PKLEN ) return 0;
+	rs = skipcopy( tmp->A,		in, 0, 	RRE);
+	rs = skipcopy( tmp->B2,		in, rs, RRE);
+	tmp->B2t = __fbase_acquire(tmp->B2, 0);
+	if( tmp->B2t == NULL ) return 0;
+	tmp->At = NULL;
+	tmp->hid = H2S_SHA512;
+	tmp->ext = 1;
+	return rs;
+}
+
+size_t __chin15_sgview(const uint8_t *in, size_t len, void *out){
+	size_t rs;
+	struct __chin15_sg *tmp = (struct __chin15_sg *)out;
+	if( len < CHIN15_SGLEN ) return 0;
+	rs = skipcopy( tmp->s1,		in, 0, 	RRS);
+	rs = skipcopy( tmp->s2,		in, rs,	RRS);
+	rs = skipcopy( tmp->x,		in, rs, RRS);
+	rs = skipcopy( tmp->U,		in, rs, RRE);
+	rs = skipcopy( tmp->B2,		in, rs, RRE);
+	tmp->B2t = __fbase_acquire(tmp->B2, 0); //the prover builds the comb
+	if( tmp->B2t == NULL ) return 0;
+	tmp->cp = NULL;
+	tmp->hid = H2S_SHA512;
+	tmp->ext = 1;
+	return rs;
+}
+
 const ds_t __chin15 = {
 	.hier = 0, //non hierarchical
 	.skgen = __chin15_skgen,
 	.pkext = __chin15_pkext,
 	.siggen = __chin15_siggen,
+	.siggen_batch = __chin15_siggen_batch,
 	.sigvrf = __chin15_sigvrf,
+	.sigvrf_batch = __chin15_sigvrf_batch,
 	.skfree = __chin15_skfree,
 	.pkfree = __chin15_pkfree,
 	.sgfree = __chin15_sgfree,
@@ -445,11 +831,94 @@ const ds_t __chin15 = {
 	.skconstr = __chin15_skconstr,
 	.pkconstr = __chin15_pkconstr,
 	.sgconstr = __chin15_sgconstr,
+	.pkview = __chin15_pkview,
+	.sgview = __chin15_sgview,
+	.pkprep = __chin15_pkprep,
 	.sklen = CHIN15_SKLEN,
 	.pklen = CHIN15_PKLEN,
 	.sglen = CHIN15_SGLEN,
+	.vlen = CHIN15_VLEN,
 };
 
+// chin15 hashing with BLAKE2b-512 instead of SHA-512, only the key setup
+// differs as every other function follows the choice on the key
+void __chin15b_skgen(void **out){
+	__chin15_skgen(out);
+	((struct __chin15_sk *)(*out))->pub->hid = H2S_BLAKE2B;
+}
+
+size_t __chin15b_pkconstr(const uint8_t *in, void **out){
+	size_t rs = __chin15_pkconstr(in, out);
+	((struct __chin15_pk *)(*out))->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+size_t __chin15b_skconstr(const uint8_t *in, void **out){
+	size_t rs = __chin15_skconstr(in, out);
+	((struct __chin15_sk *)(*out))->pub->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+size_t __chin15b_sgconstr(const uint8_t *in, void **out){
+	size_t rs = __chin15_sgconstr(in, out);
+	if( rs == 0 ) return 0;
+	((struct __chin15_sg *)(*out))->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+size_t __chin15b_pkview(const uint8_t *in, size_t len, void *out){
+	size_t rs = __chin15_pkview(in, len, out);
+	((struct __chin15_pk *)out)->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+size_t __chin15b_sgview(const uint8_t *in, size_t len, void *out){
+	size_t rs = __chin15_sgview(in, len, out);
+	((struct __chin15_sg *)out)->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+const ds_t __chin15b = {
+	.hier = 0, //non hierarchical
+	.skgen = __chin15b_skgen,
+	.pkext = __chin15_pkext,
+	.siggen = __chin15_siggen,
+	.siggen_batch = __chin15_siggen_batch,
+	.sigvrf = __chin15_sigvrf,
+	.sigvrf_batch = __chin15_sigvrf_batch,
+	.skfree = __chin15_skfree,
+	.pkfree = __chin15_pkfree,
+	.sgfree = __chin15_sgfree,
+	.skprint = __chin15_skprint,
+	.pkprint = __chin15_pkprint,
+	.sgprint = __chin15_sgprint,
+	.skserial = __chin15_skserial,
+	.pkserial = __chin15_pkserial,
+	.sgserial = __chin15_sgserial,
+	.skconstr = __chin15b_skconstr,
+	.pkconstr = __chin15b_pkconstr,
+	.sgconstr = __chin15b_sgconstr,
+	.pkview = __chin15b_pkview,
+	.sgview = __chin15b_sgview,
+	.pkprep = __chin15_pkprep,
+	.sklen = CHIN15_SKLEN,
+	.pklen = CHIN15_PKLEN,
+	.sglen = CHIN15_SGLEN,
+	.vlen = CHIN15_VLEN,
+};
+
+//start a commitment pool of n entries on a user key
+int __chin15_uprep(void *vusk, size_t n){
+	struct __chin15_sg *usk = (struct __chin15_sg *)vusk;
+	ge_fbase_t *B2t;
+	if( usk->cp != NULL ) return 0; //already prepared
+	B2t = __fbase_acquire(usk->B2, 1); //with the comb, which a view lacks
+	if( B2t == NULL ) return -1;
+	usk->cp = __cpool_new(B2t, n);
+	__fbase_release(B2t); //the pool holds its own
+	return (usk->cp == NULL) ? -1 : 0;
+}
+
 const ibi_t chin15 = {
 	.ds = (ds_t *)&__chin15,
 	.prvinit = __chin15_prvinit, //proto
@@ -457,10 +926,75 @@ const ibi_t chin15 = {
 	.resgen = __chin15_resgen,
 	.verinit = __chin15_verinit,
 	.chagen = __chin15_chagen,
+	.verpre = __chin15_verpre,
+	.protdc = __chin15_protdc,
+	.uprep = __chin15_uprep,
+	.dcprep = __chin15_dcprep,
+	.prvinit_at = __chin15_prvinit_at,
+	.verinit_at = __chin15_verinit_at,
+	.cmtlen = CHIN15_CMTLEN,
+	.chalen = CHIN15_CHALEN,
+	.reslen = CHIN15_RESLEN,
+	.stlen = CHIN15_STLEN,
+};
+
+// chin15 with 128 bit challenges, the verifier runs half length scalars
+const ibi_t chin15s = {
+	.ds = (ds_t *)&__chin15,
+	.prvinit = __chin15_prvinit, //proto
+	.cmtgen = __chin15_cmtgen,
+	.resgen = __chin15s_resgen,
+	.verinit = __chin15s_verinit,
+	.chagen = __chin15s_chagen,
+	.verpre = __chin15_verpre,
+	.protdc = __chin15s_protdc,
+	.uprep = __chin15_uprep,
+	.dcprep = __chin15_dcprep,
+	.prvinit_at = __chin15_prvinit_at,
+	.verinit_at = __chin15s_verinit_at,
+	.cmtlen = CHIN15_CMTLEN,
+	.chalen = CHIN15S_CHALEN,
+	.reslen = CHIN15_RESLEN,
+	.stlen = CHIN15_STLEN,
+};
+
+// BLAKE2b-512 hash-to-scalar, the protocol follows the key
+const ibi_t chin15b = {
+	.ds = (ds_t *)&__chin15b,
+	.prvinit = __chin15_prvinit, //proto
+	.cmtgen = __chin15_cmtgen,
+	.resgen = __chin15_resgen,
+	.verinit = __chin15_verinit,
+	.chagen = __chin15_chagen,
+	.verpre = __chin15_verpre,
 	.protdc = __chin15_protdc,
+	.uprep = __chin15_uprep,
+	.dcprep = __chin15_dcprep,
+	.prvinit_at = __chin15_prvinit_at,
+	.verinit_at = __chin15_verinit_at,
 	.cmtlen = CHIN15_CMTLEN,
 	.chalen = CHIN15_CHALEN,
 	.reslen = CHIN15_RESLEN,
+	.stlen = CHIN15_STLEN,
+};
+
+const ibi_t chin15sb = {
+	.ds = (ds_t *)&__chin15b,
+	.prvinit = __chin15_prvinit, //proto
+	.cmtgen = __chin15_cmtgen,
+	.resgen = __chin15s_resgen,
+	.verinit = __chin15s_verinit,
+	.chagen = __chin15s_chagen,
+	.verpre = __chin15_verpre,
+	.protdc = __chin15s_protdc,
+	.uprep = __chin15_uprep,
+	.dcprep = __chin15_dcprep,
+	.prvinit_at = __chin15_prvinit_at,
+	.verinit_at = __chin15s_verinit_at,
+	.cmtlen = CHIN15_CMTLEN,
+	.chalen = CHIN15S_CHALEN,
+	.reslen = CHIN15_RESLEN,
+	.stlen = CHIN15_STLEN,
 };
 
 // Hierarchical IBI implementation
@@ -481,10 +1015,10 @@ size_t __vangujar19_sgserial(void *in, uint8_t *out){
 
 struct __vangujar19_sg *__vangujar19_sginit(size_t hnlen){
 	struct __vangujar19_sg *out;
-	out = (struct __vangujar19_sg *)malloc( sizeof( struct __vangujar19_sg) );
+	out = (struct __vangujar19_sg *)malloc( sizeof( struct __vangujar19_sg) + hnlen );
 	out->hf = 1; //this is a hierarchical key
-	out->hn = (uint8_t *)malloc(hnlen);
-	out->A = (uint8_t *)malloc(RRE);
+	out->ext = 0;
+	out->hn = out->hnb;
 	out->hnlen = hnlen;
 	return out;
 };
@@ -494,19 +1028,53 @@ size_t __vangujar19_sgconstr(const uint8_t *in, void **out){
 	struct __vangujar19_sg *tmp = __vangujar19_sginit(hnlen);
 	tmp->hl = in[2];
 	size_t rs =3; //3 consumed
-	rs += __chin15.sgconstr( (in+rs), &(tmp->d) );
+	size_t dl = __chin15.sgconstr( (in+rs), &(tmp->d) );
+	if( dl == 0 ){
+		free(tmp);
+		*out = NULL;
+		return 0;
+	}
+	rs += dl;
 	rs = skipcopy( tmp->A,		in, rs, RRE);
 	rs = skipcopy( tmp->hn,		in, rs,	tmp->hnlen);
 	*out = (void *) tmp;
 	return rs;
 }
 
+// view in caller storage of VANGUJAR19_VLEN bytes, the chin15 signature
+// follows and hn points into in
+static size_t __vangujar19_sgview_l(const uint8_t *in, size_t len, void *out,
+		size_t (*dview)(const uint8_t *, size_t, void *)){
+	struct __vangujar19_sg *tmp = (struct __vangujar19_sg *)out;
+	size_t hnlen, dl, rs = 3; //3 consumed
+	if( len < VANGUJAR19_SGBSLEN ) return 0;
+	hnlen = (size_t)(in[0] | (in[1] << 8));
+	if( len - VANGUJAR19_SGBSLEN < hnlen ) return 0;
+	tmp->hf = 1;
+	tmp->hl = in[2];
+	tmp->hnlen = hnlen;
+	tmp->ext = 1;
+	tmp->d = (uint8_t *)out + sizeof(struct __vangujar19_sg);
+	dl = dview( (in+rs), len-rs, tmp->d );
+	if( dl == 0 ) return 0;
+	rs += dl;
+	rs = skipcopy( tmp->A,		in, rs, RRE);
+	tmp->hn = (uint8_t *)(in + rs);
+	return rs + hnlen;
+}
+
+size_t __vangujar19_sgview(const uint8_t *in, size_t len, void *out){
+	return __vangujar19_sgview_l(in, len, out, __chin15_sgview);
+}
+
+size_t __vangujar19b_sgview(const uint8_t *in, size_t len, void *out){
+	return __vangujar19_sgview_l(in, len, out, __chin15b_sgview);
+}
+
 void __vangujar19_sgfree(void *in){
 	struct __vangujar19_sg *ri = (struct __vangujar19_sg *)in;
 	__chin15.sgfree( ri->d ); //free chin15 sig
-	free(ri->hn);
-	free(ri->A);
-	free(ri);
+	if( !ri->ext ) free(ri);
 }
 
 void __vangujar19_siggen(
@@ -543,26 +1111,26 @@ void __vangujar19_siggen(
 
 		uint8_t nonce1[RRS], nonce2[RRS];
 		//sample r (MUST RANDOMIZE, else secret key a will be exposed)
-		crypto_core_ristretto255_scalar_random(nonce1);
-		crypto_core_ristretto255_scalar_random(nonce2);
-		crypto_core_ristretto255_scalar_add(nonce1, rk->s1, nonce1);
-		crypto_core_ristretto255_scalar_add(nonce2, rk->s2, nonce2);
+		__cb->scrand(nonce1);
+		__cb->scrand(nonce2);
+		__cb->scadd(nonce1, rk->s1, nonce1);
+		__cb->scadd(nonce2, rk->s2, nonce2);
 
-		rc = crypto_scalarmult_ristretto255_base( ri->U, nonce1); // nP
-		rc += crypto_scalarmult_ristretto255(ri->B2, nonce2, rk->B2); // n2P2
-		rc += crypto_core_ristretto255_add(ri->U, ri->U, ri->B2);
+		ri->B2t = __fbase_acquire(rk->B2, 1); //rk may be a view without the comb
+		rc = __chin15_ctmul(ri->U, nonce1, nonce2, ri->B2t); // n1P + n2P2
 
-		__sodium_2rinhashexec(tmp->hn, tmp->hnlen, ri->U, key->A, ri->x);
+		__h2s(rk->hid, tmp->hn, tmp->hnlen, ri->U, key->A, ri->x);
 
 		// s1 = n1 + bs1 + x
-		crypto_core_ristretto255_scalar_add( ri->s1, ri->x, nonce1 );
+		__cb->scadd( ri->s1, ri->x, nonce1 );
 
 		// s2 = n2 + bs2 + x
-		crypto_core_ristretto255_scalar_add( ri->s2, ri->x, nonce2 );
+		__cb->scadd( ri->s2, ri->x, nonce2 );
 		assert(rc == 0);
 
 		//store B2 and A on the signature
 		memcpy( ri->B2, rk->B2, RRE );
+		ri->hid = rk->hid;
 		memcpy( tmp->A, key->A, RRE );
 		tmp->d = ri; //assign signature into
 
@@ -588,19 +1156,21 @@ void __vangujar19_sigvrf(
 		struct __chin15_pk *par = (struct __chin15_pk *)vpar;
 		struct __chin15_sg *is = (struct __chin15_sg *)(sig->d);
 
-		uint8_t tmp1[RRE], tmp2[RRE], tmp3[RRE], xp[RRS];
-
-		// U' = sB - A
-		*res = crypto_scalarmult_ristretto255_base(tmp1, is->s1); //s1B
-		*res += crypto_scalarmult_ristretto255(tmp2, is->s2, is->B2); // s2B2
-		*res += crypto_core_ristretto255_add(tmp1, tmp1, tmp2); // (s1B + s2B2)
-
-		*res = crypto_scalarmult_ristretto255_base(tmp3, is->x); //xB
-		*res += crypto_scalarmult_ristretto255(tmp2, is->x, is->B2); // xB2
-		*res += crypto_core_ristretto255_add(tmp2, tmp2, tmp3); // (xB+xB2)
-
-		*res += crypto_core_ristretto255_sub(tmp1, tmp1, tmp2); // (s1B + s2B2)
-		__sodium_2rinhashexec(sig->hn, sig->hnlen, tmp1, par->A, xp);
+		uint8_t tmp1[RRE], xp[RRS], fsc[2*RRS];
+		const ge_fbase_t *fb[3];
+		ge_p3_t r;
+
+		// U' = (s1 - x)B + (s2 - x)B2
+		*res = (__chin15_fbases(fb, par->B2t, NULL) == 0) ? -1 : 0;
+		if( *res != 0 ) return;
+		__msm_sc255(fsc, is->s1);
+		__msm_sc255(fsc+RRS, is->s2);
+		__cb->scsub(fsc, fsc, is->x);
+		__cb->scsub(fsc+RRS, fsc+RRS, is->x);
+		*res = __msm_vartime_fb(&r, fsc, fb, 2, NULL, NULL, 0);
+		__ge_tobytes(tmp1, &r);
+
+		__h2s(par->hid, sig->hn, sig->hnlen, tmp1, par->A, xp);
 		*res += crypto_verify_32( xp, is->x );
 
 		// ensure last name in hn is same as mbuf
@@ -620,11 +1190,17 @@ void __vangujar19_sgprint(void *in){
 	printf("A :"); ucbprint(ri->A, RRE); printf("\n");
 }
 
-size_t __vangujar19_fqnread(void *vusk, uint8_t **fqn){
+size_t __vangujar19_fqnview(void *vusk, const uint8_t **fqn){
 	struct __vangujar19_sg *usk = (struct __vangujar19_sg *)vusk;
-	size_t out = usk->hnlen;
+	*fqn = usk->hn;
+	return usk->hnlen;
+}
+
+size_t __vangujar19_fqnread(void *vusk, uint8_t **fqn){
+	const uint8_t *hn;
+	size_t out = __vangujar19_fqnview(vusk, &hn);
 	*fqn = (uint8_t *)malloc(out);
-	memcpy( *fqn, usk->hn, out);
+	memcpy( *fqn, hn, out);
 	return out;
 }
 
@@ -646,10 +1222,51 @@ const ds_t __vangujar19 = {
 	.skconstr = __chin15_skconstr,
 	.pkconstr = __chin15_pkconstr,
 	.sgconstr = __vangujar19_sgconstr,
+	.pkview = __chin15_pkview,
+	.sgview = __vangujar19_sgview,
+	.pkprep = __chin15_pkprep,
+	.sklen = CHIN15_SKLEN,
+	.pklen = CHIN15_PKLEN,
+	.sglen = VANGUJAR19_SGBSLEN,
+	.fqnread = __vangujar19_fqnread,
+	.fqnview = __vangujar19_fqnview,
+	.vlen = VANGUJAR19_VLEN,
+};
+
+size_t __vangujar19b_sgconstr(const uint8_t *in, void **out){
+	size_t rs = __vangujar19_sgconstr(in, out);
+	if( rs == 0 ) return 0;
+	((struct __chin15_sg *)((struct __vangujar19_sg *)(*out))->d)->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+const ds_t __vangujar19b = {
+	.hier = 1, //is hierarchical
+	.skgen = __chin15b_skgen,
+	.pkext = __chin15_pkext,
+	.siggen = __vangujar19_siggen, //hc
+	.sigvrf = __vangujar19_sigvrf, //hc
+	.skfree = __chin15_skfree,
+	.pkfree = __chin15_pkfree,
+	.sgfree = __vangujar19_sgfree,
+	.skprint = __chin15_skprint,
+	.pkprint = __chin15_pkprint,
+	.sgprint = __vangujar19_sgprint,
+	.skserial = __chin15_skserial,
+	.pkserial = __chin15_pkserial,
+	.sgserial = __vangujar19_sgserial,
+	.skconstr = __chin15b_skconstr,
+	.pkconstr = __chin15b_pkconstr,
+	.sgconstr = __vangujar19b_sgconstr,
+	.pkview = __chin15b_pkview,
+	.sgview = __vangujar19b_sgview,
+	.pkprep = __chin15_pkprep,
 	.sklen = CHIN15_SKLEN,
 	.pklen = CHIN15_PKLEN,
 	.sglen = VANGUJAR19_SGBSLEN,
 	.fqnread = __vangujar19_fqnread,
+	.fqnview = __vangujar19_fqnview,
+	.vlen = VANGUJAR19_VLEN,
 };
 
 //mbuf and mlen unused
@@ -657,59 +1274,101 @@ void __vangujar19_prvinit(void *vusk, const uint8_t *mbuf, size_t mlen, void **s
 	struct __vangujar19_sg *usk = (struct __vangujar19_sg *)vusk;
 	struct __chin15_sg *iu = (struct __chin15_sg *)(usk->d);
 	struct __chin15_prvst *tmp; //use the same prover state
-	tmp = (struct __chin15_prvst *)malloc(sizeof(struct __chin15_prvst));
-
-	//copy secrets, vusk no longer needed
-	tmp->s1 = (uint8_t *)sodium_malloc(RRS);
-	tmp->s2 = (uint8_t *)sodium_malloc(RRS);
-	tmp->U  = (uint8_t *)malloc(RRE);
-	tmp->B2 = (uint8_t *)malloc(RRE);
-	memcpy( tmp->s1, iu->s1, RRS);
-	memcpy( tmp->s2, iu->s2, RRS);
-	memcpy( tmp->U,  iu->U, RRE);
-	memcpy( tmp->B2, iu->B2, RRE); //x is not copied as it is not needed
+	tmp = (struct __chin15_prvst *)__sarena_alloc(sizeof(struct __chin15_prvst));
+	__chin15_prvload(tmp, iu, 0);
+	tmp->hl = usk->hl;
 
 	*state = (void *)tmp; //recast and return
 }
 
-//main decision function for protocol
-void __vangujar19_protdc(const uint8_t *res, void *state, int *dec){
-	struct __chin15_verst *tmp = (struct __chin15_verst *)(state); //parse state
-
-	uint8_t rhs[RRE], lhs[RRE], tbuf[RRE], xp[RRS];
-	__sodium_2rinhashexec(tmp->mbuf, tmp->mlen, tmp->U, tmp->A, xp);
+void __vangujar19_prvinit_at(void *vusk, const uint8_t *mbuf, size_t mlen, void *state){
+	struct __vangujar19_sg *usk = (struct __vangujar19_sg *)vusk;
+	__chin15_prvload((struct __chin15_prvst *)state, (struct __chin15_sg *)(usk->d), 1);
+	((struct __chin15_prvst *)state)->hl = usk->hl;
+}
 
-	// yB = T + c( U' - xP1 )
-	*dec = crypto_scalarmult_ristretto255_base( lhs, res); //y1B1
-	*dec += crypto_scalarmult_ristretto255( tbuf, res+RRS, tmp->B2); //y2B2
-	*dec += crypto_core_ristretto255_add( lhs, lhs, tbuf); // lhs :y1B1 + y2B2
+// the chin15 commitment followed by the hier level of the key, so that the
+// verifier knows which equation to check. the prover picking it accepts
+// nothing that trying both equations would not
+void __vangujar19_cmtgen(void **state, uint8_t *cmt){
+	__chin15_cmtgen(state, cmt);
+	cmt[CHIN15_CMTLEN] = ((struct __chin15_prvst *)(*state))->hl;
+}
 
-	*dec += crypto_scalarmult_ristretto255_base(rhs, xp); //xB
-	*dec += crypto_scalarmult_ristretto255(tbuf, xp, tmp->B2); // xB2
-	*dec += crypto_core_ristretto255_add(rhs, tbuf, rhs); // (xB+xB2)
-	*dec += crypto_core_ristretto255_add(rhs, tmp->U, rhs); // U + (xB+xB2)
-	*dec += crypto_scalarmult_ristretto255(rhs, tmp->c, rhs);
+void __vangujar19_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
+	struct __chin15_verst *tmp = (struct __chin15_verst *)(*state); //parse state
+	tmp->hl = cmt[CHIN15_CMTLEN];
+	__chin15_chagen(cmt, state, cha);
+}
 
-	*dec += crypto_core_ristretto255_add(rhs, tmp->NE, rhs); // T + U + (xB+xB2)
+//main decision function for protocol, a root key (level 0) is a chin15 key
+void __vangujar19_protdc(const uint8_t *res, void *state, int *dec){
+	struct __chin15_verst *tmp = (struct __chin15_verst *)(state); //parse state
 
-	//__chin15_verstfree(state);
-	*dec += crypto_verify_32(lhs, rhs);
+	uint8_t xp[RRS], cx[RRS], fsc[2*RRS], sc[RRS];
+	const ge_fbase_t *fb[3];
+	ge_p3_t U, T, r;
 
-	//try default if fail
-	if(*dec != 0){
+	if( tmp->hl == 0 ){
 		__chin15_protdc(res, state, dec);
+		return;
+	}
+	__h2s(tmp->hid, tmp->m, tmp->mlen, tmp->U, tmp->A, xp);
+
+	// y1B + y2B2 = T + c( U' + xB + xB2 )
+	//  <=>  (y1 - cx)B + (y2 - cx)B2 - cU' = T
+	*dec = (__chin15_fbases(fb, tmp->B2t, NULL) == 0) ? -1 : 0;
+	*dec += __ge_frombytes(&U, tmp->U);
+	__cb->scmul(cx, tmp->c, xp);
+	__msm_sc255(fsc, res);
+	__msm_sc255(fsc+RRS, res+RRS);
+	__cb->scsub(fsc, fsc, cx);
+	__cb->scsub(fsc+RRS, fsc+RRS, cx);
+	__cb->scneg(sc, tmp->c);
+	if( *dec == 0 ){
+		*dec = __msm_vartime_fb(&r, fsc, fb, 2, sc, &U, 1);
+		*dec += __ge_frombytes(&T, tmp->NE);
+		if( *dec == 0 && !__ge_eq(&r, &T) ) *dec = -1;
 	}
+
+	__chin15_verstfree(state);
+}
+
+int __vangujar19_uprep(void *vusk, size_t n){
+	struct __vangujar19_sg *usk = (struct __vangujar19_sg *)vusk;
+	return __chin15_uprep(usk->d, n);
 }
 
 const ibi_t vangujar19 = {
 	.ds = (ds_t *)&__vangujar19,
 	.prvinit = __vangujar19_prvinit, //proto
-	.cmtgen = __chin15_cmtgen,
+	.cmtgen = __vangujar19_cmtgen,
 	.resgen = __chin15_resgen,
 	.verinit = __chin15_verinit,
-	.chagen = __chin15_chagen,
+	.chagen = __vangujar19_chagen,
 	.protdc = __vangujar19_protdc,
-	.cmtlen = CHIN15_CMTLEN,
+	.uprep = __vangujar19_uprep,
+	.prvinit_at = __vangujar19_prvinit_at,
+	.verinit_at = __chin15_verinit_at,
+	.cmtlen = VANGUJAR19_CMTLEN,
+	.chalen = CHIN15_CHALEN,
+	.reslen = CHIN15_RESLEN,
+	.stlen = CHIN15_STLEN,
+};
+
+const ibi_t vangujar19b = {
+	.ds = (ds_t *)&__vangujar19b,
+	.prvinit = __vangujar19_prvinit, //proto
+	.cmtgen = __vangujar19_cmtgen,
+	.resgen = __chin15_resgen,
+	.verinit = __chin15_verinit,
+	.chagen = __vangujar19_chagen,
+	.protdc = __vangujar19_protdc,
+	.uprep = __vangujar19_uprep,
+	.prvinit_at = __vangujar19_prvinit_at,
+	.verinit_at = __chin15_verinit_at,
+	.cmtlen = VANGUJAR19_CMTLEN,
 	.chalen = CHIN15_CHALEN,
 	.reslen = CHIN15_RESLEN,
+	.stlen = CHIN15_STLEN,
 };
@@ -27,59 +27,101 @@
 #define CHIN15_SKLEN (2*RRS+CHIN15_PKLEN)
 #define CHIN15_SGLEN (3*RRS+2*RRE)
 
+#include "__ge25519.h"
+#include "__kcache.h"
+
+struct __ge_fbase; //precomputed tables, see __fbase.h
+struct __cpool; //prover commitments, see __cpool.h
+
+// keys, signatures and protocol states are single blocks, the ones holding
+// secrets are taken from the secret arena (__sarena.h). views live in
+// caller storage
 struct __chin15_pk {
-	unsigned char *A;
-	unsigned char *B2; //second base
+	unsigned char A[RRE];
+	unsigned char B2[RRE]; //second base
+	struct __ge_fbase *B2t; //shared B2 tables
+	struct __ge_fbase *At; //prepared A, NULL unless pkprep was called
+	unsigned char hid; //hash-to-scalar, H2S_*
+	unsigned char ext; //view, released but not freed
 };
 
 struct __chin15_sk {
 	unsigned char hf;
 	struct __chin15_pk *pub;
-	unsigned char *a1;
-	unsigned char *a2;
+	unsigned char a1[RRS];
+	unsigned char a2[RRS];
 };
 
 struct __chin15_sg {
-	unsigned char *s1;
-	unsigned char *s2;
-	unsigned char *x;
-	unsigned char *U; //precomputation
-	unsigned char *B2; //second base
+	unsigned char s1[RRS];
+	unsigned char s2[RRS];
+	unsigned char x[RRS];
+	unsigned char U[RRE]; //precomputation
+	unsigned char B2[RRE]; //second base
+	struct __ge_fbase *B2t; //shared B2 tables
+	struct __cpool *cp; //NULL unless prepared with uprep
+	unsigned char hid; //of the issuer, for delegation (vangujar19)
+	unsigned char ext; //view, cleared but not freed
 };
 
 struct __chin15_prvst {
-	uint8_t *s1;
-	uint8_t *s2;
-	uint8_t *U; //precomputation
-	uint8_t *B2;
-	uint8_t *nonce1;
-	uint8_t *nonce2;
-	uint8_t *mbuf;
-	size_t mlen;
+	uint8_t s1[RRS];
+	uint8_t s2[RRS];
+	uint8_t nonce1[RRS];
+	uint8_t nonce2[RRS];
+	uint8_t U[RRE]; //precomputation
+	uint8_t T[RRE]; //pooled commitment
+	int pooled; //T is set, 0 if no pooled commitment was ready
+	struct __ge_fbase *B2t;
+	uint8_t hl; //vangujar19 hier level, sent with the commitment
+	uint8_t ext; //caller storage, cleared instead of freed
 };
 
+//the verifier's state ends with the identity, or points at the caller's
+//when it is in caller storage
 struct __chin15_verst {
-	uint8_t *A;
-	uint8_t *B2;
-	uint8_t *c; //challenge
-	uint8_t *U; //precompute
-	uint8_t *NE; //commit nonce group element
-	uint8_t *mbuf;
+	uint8_t A[RRE];
+	uint8_t hid; //hash-to-scalar of the mpk
+	struct __ge_fbase *B2t;
+	struct __ge_fbase *At; //NULL if the mpk was not prepared
+	uint8_t c[RRS]; //challenge
+	uint8_t U[RRE]; //precompute
+	uint8_t NE[RRE]; //commit nonce group element
+	uint8_t hl; //vangujar19 hier level of the prover's key
+	int pre; //verpre: 0 not run, 1 done, 2 done on a cached K, -1 failed
+	kcache_t *kc; //key cache of the verifier's context
+	uint8_t kid[KCACHE_IDLEN];
+	ge_p3_t K; //U' - xA
+	ge_p3_t Q; //T + cK
+	uint8_t ext; //caller storage, cleared instead of freed
+	const uint8_t *m; //the identity, mbuf or the caller's
 	size_t mlen;
+	uint8_t mbuf[];
 };
 
+#define CHIN15_STLEN (sizeof(struct __chin15_verst) > sizeof(struct __chin15_prvst) ? \
+		sizeof(struct __chin15_verst) : sizeof(struct __chin15_prvst))
+
 #define CHIN15_CMTLEN (2*RRE)
 #define CHIN15_CHALEN RRS
+#define CHIN15S_CHALEN 16 //chin15s, 128 bit challenges
 #define CHIN15_RESLEN (2*RRS)
+#define VANGUJAR19_CMTLEN (CHIN15_CMTLEN + 1) //U', T and the hier level
 
 #define VANGUJAR19_SGBSLEN  (CHIN15_SGLEN + RRE + 2 + 1)
 struct __vangujar19_sg {
 	uint8_t hf;
 	uint8_t hl; //hier level: 0-root
 	size_t hnlen; //hier name length
-	uint8_t *A; //public stored here as well
-	uint8_t *hn; //hier name
+	uint8_t A[RRE]; //public stored here as well
 	void *d; //key (chin15 design)
+	uint8_t ext; //view, d follows in the same storage
+	uint8_t *hn; //hier name, hnb or the view's input
+	uint8_t hnb[];
 };
 
+#define CHIN15_VLEN (sizeof(struct __chin15_sg) > sizeof(struct __chin15_pk) ? \
+		sizeof(struct __chin15_sg) : sizeof(struct __chin15_pk))
+#define VANGUJAR19_VLEN (sizeof(struct __vangujar19_sg) + CHIN15_VLEN)
+
 #endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sodium.h>
+#include "__crypto.h"
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__cpool.h"
+
+#define CPOOL_ENTLEN (2*RRS+RRE) //n1, n2, T
+#define CPOOL_BATCH 8 //entries generated per refill round (shared encoding)
+
+struct __cpool {
+	ge_fbase_t *B2t; //NULL: T = n1B
+	uint8_t *slots; //cap entries (secure memory)
+	uint8_t *scratch; //CPOOL_BATCH entries for the refill thread (secure memory)
+	size_t cap, cnt;
+	pid_t pid; //owner, entries are unusable in any other process
+	int stop;
+	pthread_mutex_t lock;
+	pthread_cond_t cv;
+	pthread_t th;
+};
+
+// fills n entries with fresh nonces and their commitments
+static int __cpool_gen(const cpool_t *p, uint8_t *e, size_t n){
+	uint8_t *sc = e + n*RRE, *T = e; //n T values, then n1 and n2 (n each)
+	int rc;
+	for(size_t i=0;i<n;i++) __cb->scrand(sc + i*RRS);
+	if( p->B2t == NULL ){
+		memset(sc + n*RRS, 0, n*RRS);
+		rc = __fbase_smul2_n(T, sc, &__fbase_B, NULL, NULL, n);
+	}else{
+		for(size_t i=0;i<n;i++) __cb->scrand(sc + (n+i)*RRS);
+		rc = __fbase_smul2_n(T, sc, &__fbase_B, sc + n*RRS, p->B2t, n);
+	}
+	return rc;
+}
+
+// entry i of a generated batch in pool layout
+static void __cpool_put(uint8_t *dst, const uint8_t *e, size_t n, size_t i){
+	const uint8_t *sc = e + n*RRE;
+	memcpy(dst, sc + i*RRS, RRS);
+	memcpy(dst + RRS, sc + (n+i)*RRS, RRS);
+	memcpy(dst + 2*RRS, e + i*RRE, RRE);
+}
+
+static void *__cpool_run(void *arg){
+	cpool_t *p = (cpool_t *)arg;
+	pthread_mutex_lock(&p->lock);
+	while( !p->stop ){
+		size_t n = p->cap - p->cnt;
+		if( n == 0 ){
+			pthread_cond_wait(&p->cv, &p->lock);
+			continue;
+		}
+		if( n > CPOOL_BATCH ) n = CPOOL_BATCH;
+		pthread_mutex_unlock(&p->lock);
+		int rc = __cpool_gen(p, p->scratch, n);
+		pthread_mutex_lock(&p->lock);
+		for(size_t i=0;rc == 0 && i<n && p->cnt < p->cap;i++){
+			__cpool_put(p->slots + p->cnt*CPOOL_ENTLEN, p->scratch, n, i);
+			p->cnt++;
+		}
+		sodium_memzero(p->scratch, CPOOL_BATCH*CPOOL_ENTLEN);
+		if( rc != 0 ) break; //unusable tables, leave the pool empty
+	}
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+cpool_t *__cpool_new(ge_fbase_t *B2t, size_t cap){
+	cpool_t *p;
+	if( cap == 0 || __fbase_init() != 0 ) return NULL;
+	if( B2t != NULL && B2t->comb == NULL ) return NULL;
+	p = (cpool_t *)calloc(1, sizeof(cpool_t));
+	if( p == NULL ) return NULL;
+	p->slots = (uint8_t *)sodium_malloc( cap*CPOOL_ENTLEN );
+	p->scratch = (uint8_t *)sodium_malloc( CPOOL_BATCH*CPOOL_ENTLEN );
+	if( p->slots == NULL || p->scratch == NULL ) goto fail;
+	p->B2t = __fbase_dup(B2t);
+	p->cap = cap;
+	p->pid = getpid();
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->cv, NULL);
+	if( pthread_create(&p->th, NULL, __cpool_run, p) != 0 ){
+		pthread_mutex_destroy(&p->lock);
+		pthread_cond_destroy(&p->cv);
+		__fbase_release(p->B2t);
+		goto fail;
+	}
+	return p;
+fail:
+	sodium_free(p->slots);
+	sodium_free(p->scratch);
+	free(p);
+	return NULL;
+}
+
+void __cpool_free(cpool_t *p){
+	if( p == NULL ) return;
+	if( p->pid == getpid() ){
+		pthread_mutex_lock(&p->lock);
+		p->stop = 1;
+		pthread_cond_signal(&p->cv);
+		pthread_mutex_unlock(&p->lock);
+		pthread_join(p->th, NULL);
+		pthread_mutex_destroy(&p->lock);
+		pthread_cond_destroy(&p->cv);
+	}
+	//in a forked child the thread does not exist and the lock may be stale
+	sodium_free(p->slots); //zeroes
+	sodium_free(p->scratch);
+	__fbase_release(p->B2t);
+	free(p);
+}
+
+int __cpool_pop(cpool_t *p, uint8_t *n1, uint8_t *n2, uint8_t *T){
+	uint8_t *e;
+	int rc = -1;
+	if( p == NULL ) return -1;
+	if( p->pid != getpid() ){
+		// forked, the parent holds the same nonces. wipe (single threaded here)
+		if( p->cap > 0 ) sodium_memzero(p->slots, p->cap*CPOOL_ENTLEN);
+		p->cap = p->cnt = 0;
+		return -1;
+	}
+	pthread_mutex_lock(&p->lock);
+	if( p->cnt > 0 ){
+		p->cnt--;
+		e = p->slots + p->cnt*CPOOL_ENTLEN;
+		memcpy(n1, e, RRS);
+		if( n2 != NULL ) memcpy(n2, e+RRS, RRS);
+		memcpy(T, e+2*RRS, RRE);
+		sodium_memzero(e, CPOOL_ENTLEN);
+		pthread_cond_signal(&p->cv);
+		rc = 0;
+	}
+	pthread_mutex_unlock(&p->lock);
+	return rc;
+}
@@ -22,6 +22,7 @@
 
 #include <sodium.h>
 #include "__crypto.h"
+#include "__drbg.h"
 #include "utils/debug.h"
 
 int __sodium_init(){
@@ -55,3 +56,105 @@ void __sodium_2rinhashexec(
 		oarr, (const uint8_t *)tbuf
 	);
 }
+
+static const uint8_t __h2s_tag[] = "libghibli h2s"; //blake2b key, domain separation
+
+static void __blake2b_2rinhashexec(const uint8_t *mbuf, size_t mlen,
+		const uint8_t *ubuf, const uint8_t *vbuf, uint8_t *oarr){
+	crypto_generichash_blake2b_state state;
+	uint8_t tbuf[RRH];
+	crypto_generichash_blake2b_init( &state, __h2s_tag, sizeof(__h2s_tag)-1, RRH );
+	crypto_generichash_blake2b_update( &state, mbuf, mlen);
+	crypto_generichash_blake2b_update( &state, ubuf, RRE);
+	crypto_generichash_blake2b_update( &state, vbuf, RRE);
+	crypto_generichash_blake2b_final( &state, tbuf, RRH);
+	__cb->screduce(oarr, tbuf);
+	sodium_memzero(&state, sizeof(state));
+}
+
+void __h2s(uint8_t hid, const uint8_t *m, size_t mlen, const uint8_t *u, const uint8_t *v, uint8_t *s){
+	if( hid == H2S_BLAKE2B ) __blake2b_2rinhashexec(m, mlen, u, v, s);
+	else __cb->h2s(m, mlen, u, v, s);
+}
+
+void __h2s_n(uint8_t hid, size_t n, const uint8_t *const *m, const size_t *mlen,
+		const uint8_t *const *u, const uint8_t *const *v, uint8_t *s){
+	if( hid != H2S_BLAKE2B ){
+		__cb->h2s_n(n, m, mlen, u, v, s);
+		return;
+	}
+	for(size_t i=0;i<n;i++) __blake2b_2rinhashexec(m[i], mlen[i], u[i], v[i], s + i*RRS);
+}
+
+// reference backend, thin wrappers over libsodium
+static void __cbs_scrand(uint8_t *s){
+	uint8_t h[RRH];
+	__drbg_bytes(h, RRH);
+	crypto_core_ristretto255_scalar_reduce(s, h); //bias below 2^-250
+	sodium_memzero(h, RRH);
+}
+static void __cbs_screduce(uint8_t *s, const uint8_t *h){
+	crypto_core_ristretto255_scalar_reduce(s, h);
+}
+static void __cbs_scadd(uint8_t *s, const uint8_t *a, const uint8_t *b){
+	crypto_core_ristretto255_scalar_add(s, a, b);
+}
+static void __cbs_scsub(uint8_t *s, const uint8_t *a, const uint8_t *b){
+	crypto_core_ristretto255_scalar_sub(s, a, b);
+}
+static void __cbs_scmul(uint8_t *s, const uint8_t *a, const uint8_t *b){
+	crypto_core_ristretto255_scalar_mul(s, a, b);
+}
+static void __cbs_scneg(uint8_t *s, const uint8_t *a){
+	crypto_core_ristretto255_scalar_negate(s, a);
+}
+static int __cbs_ptbase(uint8_t *p, const uint8_t *n){
+	return crypto_scalarmult_ristretto255_base(p, n);
+}
+static int __cbs_ptbase_n(size_t n, uint8_t *p, const uint8_t *s){
+	int rc = 0;
+	for(size_t i=0;i<n;i++) rc |= __cbs_ptbase(p + i*RRE, s + i*RRS);
+	return rc;
+}
+static void __cbs_ptrand(uint8_t *p){
+	uint8_t h[RRH];
+	__drbg_bytes(h, RRH);
+	crypto_core_ristretto255_from_hash(p, h);
+}
+static void __cbs_h2s(const uint8_t *m, size_t mlen, const uint8_t *u, const uint8_t *v, uint8_t *s){
+	__sodium_2rinhashexec(m, mlen, (uint8_t *)u, (uint8_t *)v, s);
+}
+static void __cbs_h2s_n(size_t n, const uint8_t *const *m, const size_t *mlen,
+		const uint8_t *const *u, const uint8_t *const *v, uint8_t *s){
+	for(size_t i=0;i<n;i++) __cbs_h2s(m[i], mlen[i], u[i], v[i], s + i*RRS);
+}
+static void __cbs_randbytes(uint8_t *b, size_t n){
+	__drbg_bytes(b, n);
+}
+
+const crypto_backend_t __cb_sodium = {
+	.name = "sodium",
+	.scrand = __cbs_scrand,
+	.screduce = __cbs_screduce,
+	.scadd = __cbs_scadd,
+	.scsub = __cbs_scsub,
+	.scmul = __cbs_scmul,
+	.scneg = __cbs_scneg,
+	.ptbase = __cbs_ptbase,
+	.ptbase_n = __cbs_ptbase_n,
+	.ptrand = __cbs_ptrand,
+	.h2s = __cbs_h2s,
+	.h2s_n = __cbs_h2s_n,
+	.randbytes = __cbs_randbytes,
+};
+
+const crypto_backend_t *__cb = &__cb_sodium;
+
+// libsodium is always initialized (secure memory, randomness)
+int __crypto_init(void){
+	int rc = __sodium_init();
+#ifdef ULNATIVE
+	if( rc == 0 && __cb_native_ok() ) __cb = &__cb_native;
+#endif
+	return rc;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// in-tree crypto backend: 64 bit montgomery scalars, constant time comb for
+// nB (four lanes wide, batched encoding in bulk) and multi-buffer sha512 for
+// hash-to-scalar. all randomness (ptrand included) comes from the drbg
+
+#include <string.h>
+#include <sodium.h>
+#include "__crypto.h"
+#include "__drbg.h"
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__sc25519.h"
+#include "__sha512x.h"
+
+static void __cbn_scrand(uint8_t *s){
+	uint8_t h[RRH];
+	__drbg_bytes(h, RRH);
+	__sc_reduce(s, h); //bias below 2^-250
+	sodium_memzero(h, RRH);
+}
+
+// same input handling as crypto_scalarmult_ristretto255_base (top bit ignored)
+static int __cbn_ptbase(uint8_t *p, const uint8_t *n){
+	uint8_t t[RRS];
+	ge_p3_t h;
+	int rc;
+	memcpy(t, n, RRS);
+	t[31] &= 127;
+	__fbase_smul(&h, t, &__fbase_B);
+	__ge_tobytes(p, &h);
+	rc = __ge_is_identity(&h) ? -1 : 0;
+	sodium_memzero(t, RRS);
+	sodium_memzero(&h, sizeof(h));
+	return rc;
+}
+
+// the comb runs four scalars at a time (avx2) and the encodings share a
+// single inversion, for bulk issuance
+static int __cbn_ptbase_n(size_t n, uint8_t *p, const uint8_t *s){
+	uint8_t *t = (uint8_t *)sodium_malloc( n*RRS );
+	int rc = -1;
+	if( t != NULL ){
+		// reduced, the comb has to see the top bit cleared value mod l
+		for(size_t i=0;i<n;i++){
+			uint8_t w[RRH] = {0};
+			memcpy(w, s + i*RRS, RRS);
+			w[31] &= 127;
+			__sc_reduce(t + i*RRS, w);
+			sodium_memzero(w, RRH);
+		}
+		rc = __fbase_smul2_n(p, t, &__fbase_B, NULL, NULL, n);
+		sodium_free(t);
+	}
+	if( rc != 0 ){
+		rc = 0;
+		for(size_t i=0;i<n;i++) rc |= __cbn_ptbase(p + i*RRE, s + i*RRS);
+		return rc;
+	}
+	for(size_t i=0;i<n;i++){
+		if( sodium_is_zero(p + i*RRE, RRE) ) rc = -1;
+	}
+	return rc;
+}
+
+static void __cbn_ptrand(uint8_t *p){
+	uint8_t h[RRH];
+	__drbg_bytes(h, RRH);
+	crypto_core_ristretto255_from_hash(p, h);
+}
+
+static void __cbn_h2s(const uint8_t *m, size_t mlen, const uint8_t *u, const uint8_t *v, uint8_t *s){
+	__sodium_2rinhashexec(m, mlen, (uint8_t *)u, (uint8_t *)v, s);
+}
+
+static void __cbn_randbytes(uint8_t *b, size_t n){
+	__drbg_bytes(b, n);
+}
+
+// the scalar code is built for bmi2 on x86-64, the comb needs its tables
+int __cb_native_ok(void){
+	if( __fbase_init() != 0 ) return 0;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("bmi2");
+#else
+	return 1;
+#endif
+}
+
+const crypto_backend_t __cb_native = {
+	.name = "native",
+	.scrand = __cbn_scrand,
+	.screduce = __sc_reduce,
+	.scadd = __sc_add,
+	.scsub = __sc_sub,
+	.scmul = __sc_mul,
+	.scneg = __sc_negate,
+	.ptbase = __cbn_ptbase,
+	.ptbase_n = __cbn_ptbase_n,
+	.ptrand = __cbn_ptrand,
+	.h2s = __cbn_h2s,
+	.h2s_n = __sha512x_2rinhashexec,
+	.randbytes = __cbn_randbytes,
+};
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sodium.h>
+#include "__crypto.h"
+#include "__msm.h"
+#include "__dcq.h"
+#include "ds.h"
+
+struct __dcq {
+	struct __ibi_dcent *ent; //pending sessions
+	size_t n, cap;
+	unsigned long lat; //us, 0 if unbounded
+	struct timespec due; //deadline of the oldest pending session
+	int stop;
+	int timer; //the timer thread runs (lat > 0)
+	pthread_mutex_t lock;
+	pthread_cond_t cv;
+	pthread_t th;
+};
+
+// slot of f among the fixed bases (fb[0] is B), appended if new
+static size_t __dcq_fbslot(const ge_fbase_t **fb, size_t *nf, const ge_fbase_t *f){
+	size_t k;
+	for(k=1;k<*nf && fb[k] != f;k++);
+	if( k == *nf ) fb[(*nf)++] = f;
+	return k;
+}
+
+// sum z_i( y1_i B + y2_i B2_i - c_i U_i + cx_i A_i - T_i ) == 0 for random 128bit z_i
+static int __dcq_chk(void *ctx, const size_t *idx, size_t n){
+	struct __ibi_dcent *ent = (struct __ibi_dcent *)ctx;
+	uint8_t *fsc = (uint8_t *)calloc( 2*n+1, RRS );
+	uint8_t *sc = (uint8_t *)calloc( 3*n, RRS );
+	ge_p3_t *pt = (ge_p3_t *)malloc( 3*n*sizeof(ge_p3_t) );
+	const ge_fbase_t **fb = (const ge_fbase_t **)malloc( (2*n+1)*sizeof(ge_fbase_t *) );
+	const uint8_t **ab = (const uint8_t **)malloc( n*sizeof(uint8_t *) ); //distinct decoded A
+	size_t *at = (size_t *)malloc( n*sizeof(size_t) ); //and their terms
+	uint8_t z[RRS], t[RRS]; ge_p3_t r;
+	size_t nf = 1, c = 0, na = 0, k;
+	int rc = -1;
+
+	if( fsc == NULL || sc == NULL || pt == NULL || fb == NULL || ab == NULL || at == NULL ) goto done;
+	fb[0] = &__fbase_B;
+	memset(z, 0, RRS);
+	for(size_t i=0;i<n;i++){
+		struct __ibi_dcent *e = &ent[idx[i]];
+		__cb->randbytes(z, 16);
+		__cb->scmul(t, z, e->y1);
+		__cb->scadd(fsc, fsc, t);
+		if( e->B2t != NULL ){
+			k = __dcq_fbslot(fb, &nf, e->B2t);
+			__cb->scmul(t, z, e->y2);
+			__cb->scadd(fsc + k*RRS, fsc + k*RRS, t);
+		}
+		__cb->scmul(t, z, e->cx);
+		if( e->At != NULL ){
+			k = __dcq_fbslot(fb, &nf, e->At);
+			__cb->scadd(fsc + k*RRS, fsc + k*RRS, t);
+		}else{
+			for(k=0;k<na && memcmp(ab[k], e->Ab, RRE) != 0;k++);
+			if( k == na ){
+				ab[na] = e->Ab;
+				at[na++] = c;
+				pt[c++] = e->A;
+			}
+			__cb->scadd(sc + at[k]*RRS, sc + at[k]*RRS, t);
+		}
+		__cb->scmul(t, z, e->c);
+		__cb->scneg(sc + c*RRS, t);
+		pt[c++] = e->U;
+		__cb->scneg(sc + c*RRS, z);
+		pt[c++] = e->T;
+	}
+	rc = __msm_vartime_fb(&r, fsc, fb, nf, sc, pt, c);
+	if( rc == 0 && !__ge_is_identity(&r) ) rc = -1;
+done:
+	free(fsc); free(sc); free(pt);
+	free(fb); free(ab); free(at);
+	return rc;
+}
+
+// settles n sessions and reports them, the entries' references are dropped
+static void __dcq_decide(struct __ibi_dcent *ent, size_t n){
+	size_t *idx = (size_t *)calloc( n, sizeof(size_t) );
+	int *res = (int *)malloc( n*sizeof(int) );
+	if( idx == NULL || res == NULL ){
+		//no memory to check them, every session fails
+		for(size_t i=0;i<n;i++){
+			ent[i].cb(ent[i].arg, -1);
+			__fbase_release(ent[i].At);
+			__fbase_release(ent[i].B2t);
+		}
+		free(idx);
+		free(res);
+		return;
+	}
+	for(size_t i=0;i<n;i++){
+		idx[i] = i;
+		res[i] = -1;
+	}
+	__ds_bisect((void *)ent, __dcq_chk, idx, n, res);
+	for(size_t i=0;i<n;i++){
+		ent[i].cb(ent[i].arg, res[i]);
+		__fbase_release(ent[i].At);
+		__fbase_release(ent[i].B2t);
+	}
+	free(idx);
+	free(res);
+}
+
+// moves the pending sessions out (lock held), NULL if there are none
+// a fresh buffer takes their place, or the next push allocates one
+static struct __ibi_dcent *__dcq_take(dcq_t *q, size_t *n){
+	struct __ibi_dcent *out = q->ent;
+	*n = q->n;
+	if( q->n == 0 ) return NULL;
+	q->ent = (struct __ibi_dcent *)malloc( q->cap*sizeof(struct __ibi_dcent) );
+	q->n = 0;
+	return out;
+}
+
+static int __dcq_expired(const dcq_t *q){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec > q->due.tv_sec) ||
+		(now.tv_sec == q->due.tv_sec && now.tv_nsec >= q->due.tv_nsec);
+}
+
+// decides the pending sessions once the oldest has waited lat
+static void *__dcq_run(void *arg){
+	dcq_t *q = (dcq_t *)arg;
+	struct __ibi_dcent *b;
+	size_t n;
+	pthread_mutex_lock(&q->lock);
+	while( !q->stop ){
+		if( q->n == 0 ){
+			pthread_cond_wait(&q->cv, &q->lock);
+			continue;
+		}
+		if( !__dcq_expired(q) ){
+			pthread_cond_timedwait(&q->cv, &q->lock, &q->due);
+			continue;
+		}
+		b = __dcq_take(q, &n);
+		pthread_mutex_unlock(&q->lock);
+		if( b != NULL ){
+			__dcq_decide(b, n);
+			free(b);
+		}
+		pthread_mutex_lock(&q->lock);
+	}
+	pthread_mutex_unlock(&q->lock);
+	return NULL;
+}
+
+dcq_t *__dcq_new(size_t cap, unsigned long lat){
+	dcq_t *q;
+	pthread_condattr_t ca;
+	if( cap == 0 || __fbase_init() != 0 ) return NULL;
+	q = (dcq_t *)calloc(1, sizeof(dcq_t));
+	if( q == NULL ) return NULL;
+	q->ent = (struct __ibi_dcent *)malloc( cap*sizeof(struct __ibi_dcent) );
+	if( q->ent == NULL ){
+		free(q);
+		return NULL;
+	}
+	q->cap = cap;
+	q->lat = lat;
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_condattr_init(&ca);
+	pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+	pthread_cond_init(&q->cv, &ca);
+	pthread_condattr_destroy(&ca);
+	if( lat > 0 ) q->timer = (pthread_create(&q->th, NULL, __dcq_run, q) == 0);
+	if( lat > 0 && !q->timer ){
+		pthread_mutex_destroy(&q->lock);
+		pthread_cond_destroy(&q->cv);
+		free(q->ent);
+		free(q);
+		return NULL;
+	}
+	return q;
+}
+
+void __dcq_push(dcq_t *q, const struct __ibi_dcent *e){
+	struct __ibi_dcent *b = NULL, one;
+	size_t n = 0;
+	pthread_mutex_lock(&q->lock);
+	if( q->ent == NULL ){
+		q->ent = (struct __ibi_dcent *)malloc( q->cap*sizeof(struct __ibi_dcent) );
+	}
+	if( q->ent == NULL ){
+		//no buffer, this session is decided on its own
+		one = *e;
+		pthread_mutex_unlock(&q->lock);
+		__dcq_decide(&one, 1);
+		return;
+	}
+	if( q->n == 0 && q->timer ){
+		clock_gettime(CLOCK_MONOTONIC, &q->due);
+		q->due.tv_sec += q->lat / 1000000;
+		q->due.tv_nsec += (long)(q->lat % 1000000) * 1000;
+		if( q->due.tv_nsec >= 1000000000L ){
+			q->due.tv_sec++;
+			q->due.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_signal(&q->cv);
+	}
+	q->ent[q->n++] = *e;
+	if( q->n == q->cap ) b = __dcq_take(q, &n);
+	pthread_mutex_unlock(&q->lock);
+	if( b != NULL ){
+		__dcq_decide(b, n);
+		free(b);
+	}
+}
+
+void __dcq_flush(dcq_t *q){
+	struct __ibi_dcent *b;
+	size_t n;
+	pthread_mutex_lock(&q->lock);
+	b = __dcq_take(q, &n);
+	pthread_mutex_unlock(&q->lock);
+	if( b != NULL ){
+		__dcq_decide(b, n);
+		free(b);
+	}
+}
+
+void __dcq_free(dcq_t *q){
+	if( q == NULL ) return;
+	if( q->timer ){
+		pthread_mutex_lock(&q->lock);
+		q->stop = 1;
+		pthread_cond_signal(&q->cv);
+		pthread_mutex_unlock(&q->lock);
+		pthread_join(q->th, NULL);
+	}
+	__dcq_flush(q);
+	pthread_mutex_destroy(&q->lock);
+	pthread_cond_destroy(&q->cv);
+	free(q->ent);
+	free(q);
+}
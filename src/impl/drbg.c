@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sodium.h>
+#ifdef __linux__
+#include <sys/random.h>
+#endif
+#include "__drbg.h"
+
+struct __drbg {
+	uint8_t key[crypto_stream_chacha20_ietf_KEYBYTES];
+	uint8_t buf[DRBG_BUFLEN];
+	size_t avail; //unread bytes at the end of buf
+	size_t out; //handed out since the last seed
+	unsigned long gen; //fork generation of the seed
+	int init;
+};
+
+static __thread struct __drbg __drbg_st;
+static unsigned long __drbg_gen = 0; //bumped in the child of every fork
+static pthread_once_t __drbg_once = PTHREAD_ONCE_INIT;
+static pthread_key_t __drbg_key;
+
+// the child runs on a copy of the forking thread's state, which must not
+// repeat the parent's stream
+static void __drbg_child(void){
+	__drbg_gen++;
+}
+
+// wipes the state when its thread exits
+static void __drbg_wipe(void *st){
+	sodium_memzero(st, sizeof(struct __drbg));
+}
+
+static void __drbg_initonce(void){
+	pthread_atfork(NULL, NULL, __drbg_child);
+	pthread_key_create(&__drbg_key, __drbg_wipe);
+}
+
+static void __drbg_seed(uint8_t *s, size_t n){
+#ifdef __linux__
+	while( n > 0 ){
+		ssize_t r = getrandom(s, n, 0);
+		if( r < 0 ){
+			if( errno == EINTR ) continue;
+			break;
+		}
+		s += r;
+		n -= (size_t)r;
+	}
+	if( n == 0 ) return;
+#endif
+	randombytes_buf(s, n); //no getrandom, libsodium picks the system source
+}
+
+static void __drbg_refill(struct __drbg *d){
+	static const uint8_t nonce[crypto_stream_chacha20_ietf_NONCEBYTES] = {0};
+	crypto_stream_chacha20_ietf(d->buf, DRBG_BUFLEN, nonce, d->key);
+	memcpy(d->key, d->buf, sizeof(d->key));
+	sodium_memzero(d->buf, sizeof(d->key));
+	d->avail = DRBG_BUFLEN - sizeof(d->key);
+}
+
+void __drbg_bytes(uint8_t *out, size_t n){
+	struct __drbg *d = &__drbg_st;
+	uint8_t *src;
+	size_t k;
+
+	if( !d->init ){
+		pthread_once(&__drbg_once, __drbg_initonce);
+		pthread_setspecific(__drbg_key, d);
+	}
+	if( !d->init || d->gen != __drbg_gen || d->out >= DRBG_RESEED ){
+		__drbg_seed(d->key, sizeof(d->key));
+		sodium_memzero(d->buf, DRBG_BUFLEN);
+		d->avail = 0;
+		d->out = 0;
+		d->gen = __drbg_gen;
+		d->init = 1;
+	}
+	while( n > 0 ){
+		if( d->avail == 0 ) __drbg_refill(d);
+		k = (n < d->avail) ? n : d->avail;
+		src = d->buf + DRBG_BUFLEN - d->avail;
+		memcpy(out, src, k);
+		sodium_memzero(src, k);
+		out += k;
+		n -= k;
+		d->avail -= k;
+		d->out += k;
+	}
+}
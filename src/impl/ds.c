@@ -30,6 +30,8 @@ ds_t *get_ds_impl(uint8_t an){
 	switch(an){
 		case 0:
 			return (ds_t *)&schnorr91;
+		case 1:
+			return (ds_t *)&schnorr91b;
 		default:
 			assert(0); //error
 			return (ds_t *)&schnorr91;
@@ -55,6 +57,7 @@ ds_k_t *__ds_kinit(uint8_t an, uint8_t t){
 	ds_k_t *out = (ds_k_t*) malloc(sizeof(ds_k_t));
 	out-> an = an;
 	out-> t = t;
+	out-> v = 0;
 	return out;
 }
 
@@ -151,7 +154,14 @@ size_t __ds_rconstr(const uint8_t *in, void **out){
 	ds_s_t *tmp = __ds_sinit(in[0]);
 	ds_t *impl = get_ds_impl(in[0]); //get algorithm
 	size_t rs = 1;
-	rs += impl->sgconstr(in+rs, &(tmp->s));
+	size_t sl = impl->sgconstr(in+rs, &(tmp->s));
+	if( sl == 0 ){
+		//the signature was rejected
+		free(tmp);
+		*out = NULL;
+		return 0;
+	}
+	rs += sl;
 	*out = (void *)tmp;
 	return rs;
 }
@@ -172,6 +182,73 @@ void __ds_verify(void *vpar, void *vsig, const uint8_t *mbuf, size_t mlen, int *
 	impl->sigvrf(pk->k, sg->s, mbuf, mlen, res);
 }
 
+// splits a failing batch in halves until the bad entries are isolated
+// chk returns 0 if the entries idx[0..n) verify together
+void __ds_bisect(void *ctx, int (*chk)(void *, const size_t *, size_t), const size_t *idx, size_t n, int *res){
+	if(n == 0) return;
+	if(chk(ctx, idx, n) == 0){
+		for(size_t i=0;i<n;i++) res[idx[i]] = 0;
+		return;
+	}
+	if(n == 1){
+		res[idx[0]] = -1;
+		return;
+	}
+	__ds_bisect(ctx, chk, idx, n/2, res);
+	__ds_bisect(ctx, chk, idx+n/2, n-n/2, res);
+}
+
+// verifies the signatures by algorithm, each entry gets its own result
+void __ds_verify_batch(void **vpars, void **vsigs, const uint8_t **mbufs, const size_t *mlens, size_t n, int *res){
+	void **ps = (void **)malloc(n*sizeof(void *));
+	void **ss = (void **)malloc(n*sizeof(void *));
+	const uint8_t **ms = (const uint8_t **)malloc(n*sizeof(uint8_t *));
+	size_t *ls = (size_t *)malloc(n*sizeof(size_t));
+	size_t *pos = (size_t *)malloc(n*sizeof(size_t));
+	int *rs = (int *)malloc(n*sizeof(int));
+	uint8_t *done = (uint8_t *)calloc(n, 1);
+
+	if( !ps || !ss || !ms || !ls || !pos || !rs || !done ){
+		//out of memory, one at a time
+		for(size_t i=0;i<n;i++) __ds_verify(vpars[i], vsigs[i], mbufs[i], mlens[i], &res[i]);
+		free(ps); free(ss); free(ms); free(ls);
+		free(pos); free(rs); free(done);
+		return;
+	}
+
+	for(size_t i=0;i<n;i++){
+		ds_k_t *pk = (ds_k_t *)vpars[i];
+		ds_s_t *sg = (ds_s_t *)vsigs[i];
+		if(pk->an != sg->an){ res[i] = 1; done[i] = 1; }
+	}
+
+	for(size_t i=0;i<n;i++){
+		if(done[i]) continue;
+		//gather every pending entry that uses the same algorithm
+		uint8_t an = ((ds_k_t *)vpars[i])->an;
+		size_t c = 0;
+		for(size_t j=i;j<n;j++){
+			if(done[j] || ((ds_k_t *)vpars[j])->an != an) continue;
+			ps[c] = ((ds_k_t *)vpars[j])->k;
+			ss[c] = ((ds_s_t *)vsigs[j])->s;
+			ms[c] = mbufs[j];
+			ls[c] = mlens[j];
+			pos[c++] = j;
+			done[j] = 1;
+		}
+		ds_t *impl = get_ds_impl(an); //get algorithm
+		if(impl->sigvrf_batch){
+			impl->sigvrf_batch(ps, ss, ms, ls, c, rs);
+		}else{
+			for(size_t j=0;j<c;j++) impl->sigvrf(ps[j], ss[j], ms[j], ls[j], &rs[j]);
+		}
+		for(size_t j=0;j<c;j++) res[pos[j]] = rs[j];
+	}
+
+	free(ps); free(ss); free(ms); free(ls);
+	free(pos); free(rs); free(done);
+}
+
 void __ds_kprint(void *in){
 	ds_k_t *tmp = (ds_k_t *)in;
 	ds_t *impl = get_ds_impl(tmp->an); //get algorithm
@@ -214,6 +291,7 @@ const ds_if_t ds = {
 	.rconstr = __ds_rconstr,
 	.sign = __ds_sign,
 	.verify = __ds_verify,
+	.verify_batch = __ds_verify_batch,
 	.sklen = __ds_sklen,
 	.pklen = __ds_pklen,
 	.sglen = __ds_sglen,
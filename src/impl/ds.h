@@ -29,6 +29,7 @@
 typedef struct __ds_k {
 	uint8_t an; //algo
 	uint8_t t; //key type
+	uint8_t v; //view over a serialized key, see ibi_if_t.kview
 	void *k; //key pointer
 } ds_k_t;
 
@@ -44,7 +45,11 @@ typedef struct __ds {
 	void (*skgen)(void **); //generate secret key
 	void (*pkext)(void *, void **); //obtain pubkey from secret
 	void (*siggen)(void *, const uint8_t *, size_t, void **);
+	//sign n messages under one key, NULL if unsupported
+	void (*siggen_batch)(void *, const uint8_t **, const size_t *, size_t, void **);
 	void (*sigvrf)(void *,void *, const uint8_t *, size_t, int *);
+	//verify n signatures at once (res is per signature), NULL if unsupported
+	void (*sigvrf_batch)(void **, void **, const uint8_t **, const size_t *, size_t, int *);
 	void (*skfree)(void *);
 	void (*pkfree)(void *);
 	void (*sgfree)(void *);
@@ -56,23 +61,37 @@ typedef struct __ds {
 	size_t (*sgserial)(void *, uint8_t *);
 	size_t (*skconstr)(const uint8_t *, void **);
 	size_t (*pkconstr)(const uint8_t *, void **);
-	size_t (*sgconstr)(const uint8_t *, void **);
+	size_t (*sgconstr)(const uint8_t *, void **); //0 and NULL if rejected
 	size_t (*fqnread)(void *, uint8_t **);
+	size_t (*fqnview)(void *, const uint8_t **); //no copy, NULL as fqnread
+	//decode a public key once and attach its tables, NULL if unsupported
+	int (*pkprep)(void *);
+	//parse a pk/sg of at most len bytes into caller storage of vlen bytes,
+	//fixed size fields are copied and the rest points into the input.
+	//pkfree/sgfree then release it without freeing, 0 if len is too short
+	size_t (*pkview)(const uint8_t *, size_t, void *);
+	size_t (*sgview)(const uint8_t *, size_t, void *);
 	const size_t sklen;
 	const size_t pklen;
 	const size_t sglen;
+	const size_t vlen;
 } ds_t;
 
 // ds implemented
 extern const ds_t schnorr91;
 extern const ds_t __chin15; //not to be used
 extern const ds_t __vangujar19; //not to be used
+// the same with BLAKE2b-512 as hash-to-scalar
+extern const ds_t schnorr91b;
+extern const ds_t __chin15b; //not to be used
+extern const ds_t __vangujar19b; //not to be used
 
 // interfaces
 typedef struct __ds_if {
 	void (*keygen)(uint8_t, void **, void **); //generate a ds_k_t sk and pk
 	void (*sign)(void *, const uint8_t *, size_t , void **); //sign msg
 	void (*verify)(void *, void *, const uint8_t *, size_t , int *); //verify msg
+	void (*verify_batch)(void **, void **, const uint8_t **, const size_t *, size_t, int *); //verify n msgs
 
 	void (*kfree)(void *); //free a ds_k_t key
 	void (*rfree)(void *); //free a signature
@@ -82,7 +101,7 @@ typedef struct __ds_if {
 	size_t (*kserial)(void *, uint8_t *, size_t); //serialize key
 	size_t (*rserial)(void *, uint8_t *, size_t); //serialize signature
 	size_t (*kconstr)(const uint8_t *, void **); //constrct key from serialization
-	size_t (*rconstr)(const uint8_t *, void **); //construct signature from serialization
+	size_t (*rconstr)(const uint8_t *, void **); //construct signature from serialization, 0 and NULL if rejected
 
 	size_t (*sklen)(uint8_t); //length of sk based on algo
 	size_t (*pklen)(uint8_t); //length of pk based on algo
@@ -103,6 +122,7 @@ ds_t *get_ds_impl(uint8_t an);
 ds_k_t *__ds_kinit(uint8_t an, uint8_t t);
 uint8_t __ds_ktread(void *in);
 uint8_t __ds_karead(void *in);
+void __ds_bisect(void *ctx, int (*chk)(void *, const size_t *, size_t), const size_t *idx, size_t n, int *res);
 //ds_s_t *__ds_sinit(uint8_t an);
 //void __ds_keygen(uint8_t an, void **skout, void **pkout);
 //void __ds_kfree(void *in);
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sodium.h>
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__msm.h"
+#include "__ifma.h"
+#include "__ge4x.h"
+#include "__crypto.h"
+
+ge_fbase_t __fbase_B;
+static ge_precomp_t __fbase_Bcomb[32][8];
+static int __fbase_Brc = -1;
+static pthread_once_t __fbase_once = PTHREAD_ONCE_INIT;
+
+static ge_fbase_t *__fbase_list = NULL;
+static pthread_mutex_t __fbase_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// fills comb from f->P, the rows are normalized to affine with a single
+// inversion
+static int __fbase_buildcomb(ge_precomp_t (*comb)[8], const ge_fbase_t *f){
+	ge_p3_t *pts = (ge_p3_t *)malloc( 256*sizeof(ge_p3_t) );
+	fe_t *acc = (fe_t *)malloc( 256*sizeof(fe_t) );
+	ge_p3_t base = f->P;
+	ge_p1p1_t t; ge_p2_t r; ge_cached_t c;
+	fe_t inv, zi, x, y;
+
+	if( pts == NULL || acc == NULL ){
+		free(pts); free(acc);
+		return -1;
+	}
+	for(int i=0;i<32;i++){
+		pts[8*i] = base;
+		__ge_p3_to_cached(&c, &base);
+		for(int j=1;j<8;j++){
+			__ge_add(&t, &pts[8*i+j-1], &c);
+			__ge_p1p1_to_p3(&pts[8*i+j], &t);
+		}
+		// base = 256 base
+		__ge_p3_to_p2(&r, &base);
+		for(int k=0;k<8;k++){
+			__ge_p2_dbl(&t, &r);
+			if( k < 7 ) __ge_p1p1_to_p2(&r, &t);
+		}
+		__ge_p1p1_to_p3(&base, &t);
+	}
+
+	// batch inversion of the 256 Z coordinates
+	__fe_copy(&acc[0], &pts[0].Z);
+	for(int k=1;k<256;k++) __fe_mul(&acc[k], &acc[k-1], &pts[k].Z);
+	__fe_invert(&inv, &acc[255]);
+	for(int k=255;k>=0;k--){
+		ge_precomp_t *p = &comb[k/8][k%8];
+		if( k > 0 ){
+			__fe_mul(&zi, &inv, &acc[k-1]);
+			__fe_mul(&inv, &inv, &pts[k].Z);
+		}else{
+			__fe_copy(&zi, &inv);
+		}
+		__fe_mul(&x, &pts[k].X, &zi);
+		__fe_mul(&y, &pts[k].Y, &zi);
+		__fe_add(&p->yplusx, &y, &x);
+		__fe_sub(&p->yminusx, &y, &x);
+		__fe_mul(&p->xy2d, &x, &y);
+		__fe_mul(&p->xy2d, &p->xy2d, &__fe_d2);
+	}
+
+	free(pts);
+	free(acc);
+	return 0;
+}
+
+static void __fbase_initonce(void){
+	__fbase_B.P = __ge_basepoint;
+	__ge_tobytes(__fbase_B.enc, &__fbase_B.P);
+	__fbase_B.comb = __fbase_Bcomb;
+	__fbase_B.hi = NULL;
+	__fbase_B.refs = 1;
+	__fbase_B.next = NULL;
+	__msm_oddtbl(__fbase_B.odd, &__fbase_B.P, FBASE_ODDN);
+	__fbase_B.odd4 = __ifma_tbl(__fbase_B.odd, FBASE_ODDN);
+	__fbase_Brc = __fbase_buildcomb(__fbase_Bcomb, &__fbase_B);
+}
+
+int __fbase_init(void){
+	pthread_once(&__fbase_once, __fbase_initonce);
+	return __fbase_Brc;
+}
+
+static void __fbase_free(ge_fbase_t *f){
+	if( f == NULL ) return;
+	__fbase_free(f->hi);
+	free(f->comb);
+	__ifma_tblfree(f->odd4);
+	free(f);
+}
+
+ge_fbase_t *__fbase_acquire(const uint8_t *enc, int ct){
+	ge_fbase_t *f;
+	pthread_mutex_lock(&__fbase_lock);
+	for(f=__fbase_list;f!=NULL;f=f->next){
+		if( memcmp(f->enc, enc, 32) == 0 ) break;
+	}
+	if( f == NULL ){
+		f = (ge_fbase_t *)malloc( sizeof(ge_fbase_t) );
+		if( f != NULL && __ge_frombytes(&f->P, enc) == 0 ){
+			memcpy(f->enc, enc, 32);
+			f->comb = NULL;
+			f->hi = NULL;
+			f->refs = 0;
+			__msm_oddtbl(f->odd, &f->P, FBASE_ODDN);
+			f->odd4 = __ifma_tbl(f->odd, FBASE_ODDN);
+			f->next = __fbase_list;
+			__fbase_list = f;
+		}else{
+			free(f);
+			f = NULL;
+		}
+	}
+	if( f != NULL && ct && f->comb == NULL ){
+		ge_precomp_t (*comb)[8] = (ge_precomp_t (*)[8])malloc( 32*sizeof(*comb) );
+		if( comb != NULL && __fbase_buildcomb(comb, f) == 0 ){
+			f->comb = comb;
+		}else{
+			free(comb);
+		}
+	}
+	if( f != NULL && ct && f->comb == NULL ){
+		// unusable for the caller, a fresh entry (still at the head) is dropped
+		if( f->refs == 0 ){
+			__fbase_list = f->next;
+			__fbase_free(f);
+		}
+		f = NULL;
+	}
+	if( f != NULL ) f->refs++;
+	pthread_mutex_unlock(&__fbase_lock);
+	return f;
+}
+
+ge_fbase_t *__fbase_dup(ge_fbase_t *f){
+	if( f == NULL ) return NULL;
+	pthread_mutex_lock(&__fbase_lock);
+	f->refs++;
+	pthread_mutex_unlock(&__fbase_lock);
+	return f;
+}
+
+void __fbase_release(ge_fbase_t *f){
+	ge_fbase_t **pp;
+	if( f == NULL ) return;
+	pthread_mutex_lock(&__fbase_lock);
+	if( --(f->refs) == 0 ){
+		for(pp=&__fbase_list;*pp!=NULL;pp=&(*pp)->next){
+			if( *pp == f ){
+				*pp = f->next;
+				break;
+			}
+		}
+		__fbase_free(f);
+	}
+	pthread_mutex_unlock(&__fbase_lock);
+}
+
+const ge_fbase_t *__fbase_hi(ge_fbase_t *f){
+	ge_fbase_t *h;
+	ge_p1p1_t t; ge_p2_t r;
+	if( f == &__fbase_B && __fbase_init() != 0 ) return NULL;
+	pthread_mutex_lock(&__fbase_lock);
+	if( f->hi == NULL && (h = (ge_fbase_t *)malloc( sizeof(ge_fbase_t) )) != NULL ){
+		__ge_p3_to_p2(&r, &f->P);
+		for(int k=0;k<128;k++){
+			__ge_p2_dbl(&t, &r);
+			if( k < 127 ) __ge_p1p1_to_p2(&r, &t);
+		}
+		__ge_p1p1_to_p3(&h->P, &t);
+		__ge_tobytes(h->enc, &h->P);
+		h->comb = NULL;
+		h->hi = NULL;
+		h->refs = 1;
+		h->next = NULL; //not in the registry, freed with f
+		__msm_oddtbl(h->odd, &h->P, FBASE_ODDN);
+		h->odd4 = __ifma_tbl(h->odd, FBASE_ODDN);
+		f->hi = h;
+	}
+	h = f->hi;
+	pthread_mutex_unlock(&__fbase_lock);
+	return h;
+}
+
+// 1 if b == c, without branching
+static inline unsigned int __fbase_eq(uint8_t b, uint8_t c){
+	uint32_t y = (uint32_t)(b ^ c);
+	y -= 1;
+	return y >> 31;
+}
+
+// t = b row[|b|-1] with the sign applied, every entry is touched
+static void __fbase_select(ge_precomp_t *t, const ge_precomp_t *row, int8_t b){
+	const uint8_t bneg = (uint8_t)b >> 7;
+	const uint8_t babs = (uint8_t)(b - (((-bneg) & b) << 1));
+	ge_precomp_t m;
+	__fe_1(&t->yplusx);
+	__fe_1(&t->yminusx);
+	__fe_0(&t->xy2d);
+	for(int j=0;j<8;j++){
+		const unsigned int s = __fbase_eq(babs, (uint8_t)(j+1));
+		__fe_cmov(&t->yplusx, &row[j].yplusx, s);
+		__fe_cmov(&t->yminusx, &row[j].yminusx, s);
+		__fe_cmov(&t->xy2d, &row[j].xy2d, s);
+	}
+	__fe_copy(&m.yplusx, &t->yminusx);
+	__fe_copy(&m.yminusx, &t->yplusx);
+	__fe_neg(&m.xy2d, &t->xy2d);
+	__fe_cmov(&t->yplusx, &m.yplusx, bneg);
+	__fe_cmov(&t->yminusx, &m.yminusx, bneg);
+	__fe_cmov(&t->xy2d, &m.xy2d, bneg);
+}
+
+void __fbase_smul(ge_p3_t *h, const uint8_t *a, const ge_fbase_t *f){
+	int8_t e[64], carry = 0;
+	ge_precomp_t t; ge_p1p1_t r; ge_p2_t s;
+
+	// signed radix 16, digits in [-8, 8]
+	for(int i=0;i<32;i++){
+		e[2*i] = a[i] & 15;
+		e[2*i+1] = (a[i] >> 4) & 15;
+	}
+	for(int i=0;i<63;i++){
+		e[i] += carry;
+		carry = (int8_t)((e[i] + 8) >> 4);
+		e[i] -= (int8_t)(carry << 4);
+	}
+	e[63] += carry;
+
+	__ge_p3_0(h);
+	for(int i=1;i<64;i+=2){
+		__fbase_select(&t, f->comb[i/2], e[i]);
+		__ge_madd(&r, h, &t);
+		__ge_p1p1_to_p3(h, &r);
+	}
+	__ge_p3_dbl(&r, h);
+	__ge_p1p1_to_p2(&s, &r);
+	__ge_p2_dbl(&r, &s);
+	__ge_p1p1_to_p2(&s, &r);
+	__ge_p2_dbl(&r, &s);
+	__ge_p1p1_to_p2(&s, &r);
+	__ge_p2_dbl(&r, &s);
+	__ge_p1p1_to_p3(h, &r);
+	for(int i=0;i<64;i+=2){
+		__fbase_select(&t, f->comb[i/2], e[i]);
+		__ge_madd(&r, h, &t);
+		__ge_p1p1_to_p3(h, &r);
+	}
+
+	sodium_memzero(e, sizeof(e));
+	sodium_memzero(&t, sizeof(t));
+}
+
+void __fbase_smul_n(ge_p3_t *h, const uint8_t *a, size_t n, const ge_fbase_t *f){
+	size_t i = 0;
+	if( __ge4x_ok() ){
+		for(;i+4<=n;i+=4) __ge4x_smul(h + i, a + 32*i, f);
+	}
+	for(;i<n;i++) __fbase_smul(&h[i], a + 32*i, f);
+}
+
+// 1/2 mod l
+static const uint8_t __fbase_half[32] = {
+	0xf7, 0xe9, 0x7a, 0x2e, 0x8d, 0x31, 0x09, 0x2c, 0x6b, 0xce, 0x7b, 0x51, 0xef, 0x7c, 0x6f, 0x0a,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08
+};
+
+int __fbase_smul2_n(uint8_t *out, const uint8_t *a, const ge_fbase_t *P,
+		const uint8_t *b, const ge_fbase_t *Q, size_t n){
+	const size_t m = (Q != NULL) ? 2 : 1;
+	uint8_t *t;
+	ge_p3_t *h;
+	int rc;
+	if( P == NULL || P->comb == NULL || (Q != NULL && Q->comb == NULL) ) return -1;
+	if( n == 0 ) return 0;
+	t = (uint8_t *)sodium_malloc( m*n*32 );
+	h = (ge_p3_t *)sodium_malloc( m*n*sizeof(ge_p3_t) );
+	if( t == NULL || h == NULL ){
+		sodium_free(t); sodium_free(h);
+		return -1;
+	}
+	// the encoder doubles, the tables run on a/2 (and b/2)
+	for(size_t i=0;i<n;i++) __cb->scmul(t + 32*i, a + 32*i, __fbase_half);
+	__fbase_smul_n(h, t, n, P);
+	if( Q != NULL ){
+		for(size_t i=0;i<n;i++) __cb->scmul(t + 32*(n+i), b + 32*i, __fbase_half);
+		__fbase_smul_n(h + n, t + 32*n, n, Q);
+		for(size_t i=0;i<n;i++) __ge_p3_add(&h[i], &h[i], &h[n+i]);
+	}
+	rc = __ge_dbl_tobytes_n(out, h, n);
+	sodium_free(t);
+	sodium_free(h);
+	return rc;
+}
+
+int __fbase_smul2(uint8_t *out, const uint8_t *a, const ge_fbase_t *P, const uint8_t *b, const ge_fbase_t *Q){
+	ge_p3_t p, q; ge_cached_t c; ge_p1p1_t t;
+	if( P == NULL || Q == NULL || P->comb == NULL || Q->comb == NULL ) return -1;
+	__fbase_smul(&p, a, P);
+	__fbase_smul(&q, b, Q);
+	__ge_p3_to_cached(&c, &q);
+	__ge_add(&t, &p, &c);
+	__ge_p1p1_to_p3(&p, &t);
+	__ge_tobytes(out, &p);
+	sodium_memzero(&p, sizeof(p));
+	sodium_memzero(&q, sizeof(q));
+	sodium_memzero(&c, sizeof(c));
+	sodium_memzero(&t, sizeof(t));
+	return 0;
+}
@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "__ge25519.h"
+
+//--------------------------field constants
+const fe_t __fe_d = {{
+	0x34dca135978a3, 0x1a8283b156ebd, 0x5e7a26001c029, 0x739c663a03cbb, 0x52036cee2b6ff
+}};
+const fe_t __fe_d2 = {{
+	0x69b9426b2f159, 0x35050762add7a, 0x3cf44c0038052, 0x6738cc7407977, 0x2406d9dc56dff
+}};
+const fe_t __fe_sqrtm1 = {{
+	0x61b274a0ea0b0, 0x0d5a5fc8f189d, 0x7ef5e9cbd0c60, 0x78595a6804c9e, 0x2b8324804fc1d
+}};
+const fe_t __fe_invsqrt_a_minus_d = {{
+	0x0fdaa805d40ea, 0x2eb482e57d339, 0x007610274bc58, 0x6510b613dc8ff, 0x786c8905cfaff
+}};
+
+// standard edwards25519 base point, encodes to the ristretto255 generator
+const ge_p3_t __ge_basepoint = {
+	{{ 0x62d608f25d51a, 0x412a4b4f6592a, 0x75b7171a4b31d, 0x1ff60527118fe, 0x216936d3cd6e5 }},
+	{{ 0x6666666666658, 0x4cccccccccccc, 0x1999999999999, 0x3333333333333, 0x6666666666666 }},
+	{{ 1, 0, 0, 0, 0 }},
+	{{ 0x68ab3a5b7dda3, 0x00eea2a5eadbb, 0x2af8df483c27e, 0x332b375274732, 0x67875f0fd78b7 }},
+};
+
+// out = z^(p-2)
+void __fe_invert(fe_t *out, const fe_t *z){
+	fe_t t0, t1, t2, t3;
+	__fe_sq(&t0, z);
+	__fe_sqn(&t1, &t0, 2);
+	__fe_mul(&t1, z, &t1);
+	__fe_mul(&t0, &t0, &t1);
+	__fe_sq(&t2, &t0);
+	__fe_mul(&t1, &t1, &t2); // 2^5 - 1
+	__fe_sqn(&t2, &t1, 5);
+	__fe_mul(&t1, &t2, &t1); // 2^10 - 1
+	__fe_sqn(&t2, &t1, 10);
+	__fe_mul(&t2, &t2, &t1); // 2^20 - 1
+	__fe_sqn(&t3, &t2, 20);
+	__fe_mul(&t2, &t3, &t2); // 2^40 - 1
+	__fe_sqn(&t2, &t2, 10);
+	__fe_mul(&t1, &t2, &t1); // 2^50 - 1
+	__fe_sqn(&t2, &t1, 50);
+	__fe_mul(&t2, &t2, &t1); // 2^100 - 1
+	__fe_sqn(&t3, &t2, 100);
+	__fe_mul(&t2, &t3, &t2); // 2^200 - 1
+	__fe_sqn(&t2, &t2, 50);
+	__fe_mul(&t1, &t2, &t1); // 2^250 - 1
+	__fe_sqn(&t1, &t1, 5);
+	__fe_mul(out, &t1, &t0); // 2^255 - 21
+}
+
+// out = z^((p-5)/8)
+void __fe_pow22523(fe_t *out, const fe_t *z){
+	fe_t t0, t1, t2;
+	__fe_sq(&t0, z);
+	__fe_sqn(&t1, &t0, 2);
+	__fe_mul(&t1, z, &t1);
+	__fe_mul(&t0, &t0, &t1);
+	__fe_sq(&t0, &t0);
+	__fe_mul(&t0, &t1, &t0); // 2^5 - 1
+	__fe_sqn(&t1, &t0, 5);
+	__fe_mul(&t0, &t1, &t0); // 2^10 - 1
+	__fe_sqn(&t1, &t0, 10);
+	__fe_mul(&t1, &t1, &t0); // 2^20 - 1
+	__fe_sqn(&t2, &t1, 20);
+	__fe_mul(&t1, &t2, &t1); // 2^40 - 1
+	__fe_sqn(&t1, &t1, 10);
+	__fe_mul(&t0, &t1, &t0); // 2^50 - 1
+	__fe_sqn(&t1, &t0, 50);
+	__fe_mul(&t1, &t1, &t0); // 2^100 - 1
+	__fe_sqn(&t2, &t1, 100);
+	__fe_mul(&t1, &t2, &t1); // 2^200 - 1
+	__fe_sqn(&t1, &t1, 50);
+	__fe_mul(&t0, &t1, &t0); // 2^250 - 1
+	__fe_sqn(&t0, &t0, 2);
+	__fe_mul(out, &t0, z); // 2^252 - 3
+}
+
+// r = sqrt(u/v) or sqrt(i*u/v), returns 1 iff u/v was square (RFC9496)
+int __fe_sqrt_ratio_m1(fe_t *r, const fe_t *u, const fe_t *v){
+	fe_t v3, v7, t, check, nu, nui;
+	int correct, flipped, flipped_i;
+
+	__fe_sq(&v3, v);
+	__fe_mul(&v3, &v3, v); // v^3
+	__fe_sq(&v7, &v3);
+	__fe_mul(&v7, &v7, v); // v^7
+	__fe_mul(&t, u, &v7);
+	__fe_pow22523(&t, &t);
+	__fe_mul(&t, &t, &v3);
+	__fe_mul(r, &t, u); // (u v^3)(u v^7)^((p-5)/8)
+
+	__fe_sq(&check, r);
+	__fe_mul(&check, &check, v);
+	__fe_neg(&nu, u);
+	__fe_mul(&nui, &nu, &__fe_sqrtm1);
+	correct = __fe_eq(&check, u);
+	flipped = __fe_eq(&check, &nu);
+	flipped_i = __fe_eq(&check, &nui);
+
+	__fe_mul(&t, r, &__fe_sqrtm1);
+	__fe_cmov(r, &t, flipped | flipped_i);
+	__fe_abs(r, r);
+	return correct | flipped;
+}
+
+//--------------------------point arithmetic
+void __ge_p3_0(ge_p3_t *h){
+	__fe_0(&h->X);
+	__fe_1(&h->Y);
+	__fe_1(&h->Z);
+	__fe_0(&h->T);
+}
+
+void __ge_p3_to_p2(ge_p2_t *r, const ge_p3_t *p){
+	__fe_copy(&r->X, &p->X);
+	__fe_copy(&r->Y, &p->Y);
+	__fe_copy(&r->Z, &p->Z);
+}
+
+void __ge_p3_to_cached(ge_cached_t *r, const ge_p3_t *p){
+	__fe_add(&r->YplusX, &p->Y, &p->X);
+	__fe_sub(&r->YminusX, &p->Y, &p->X);
+	__fe_copy(&r->Z, &p->Z);
+	__fe_mul(&r->T2d, &p->T, &__fe_d2);
+}
+
+void __ge_p1p1_to_p2(ge_p2_t *r, const ge_p1p1_t *p){
+	__fe_mul(&r->X, &p->X, &p->T);
+	__fe_mul(&r->Y, &p->Y, &p->Z);
+	__fe_mul(&r->Z, &p->Z, &p->T);
+}
+
+void __ge_p1p1_to_p3(ge_p3_t *r, const ge_p1p1_t *p){
+	__fe_mul(&r->X, &p->X, &p->T);
+	__fe_mul(&r->Y, &p->Y, &p->Z);
+	__fe_mul(&r->Z, &p->Z, &p->T);
+	__fe_mul(&r->T, &p->X, &p->Y);
+}
+
+void __ge_p2_dbl(ge_p1p1_t *r, const ge_p2_t *p){
+	fe_t t0;
+	__fe_sq(&r->X, &p->X);
+	__fe_sq(&r->Z, &p->Y);
+	__fe_sq(&r->T, &p->Z);
+	__fe_add(&r->T, &r->T, &r->T);
+	__fe_add(&r->Y, &p->X, &p->Y);
+	__fe_sq(&t0, &r->Y);
+	__fe_add(&r->Y, &r->Z, &r->X);
+	__fe_sub(&r->Z, &r->Z, &r->X);
+	__fe_sub(&r->X, &t0, &r->Y);
+	__fe_sub(&r->T, &r->T, &r->Z);
+}
+
+void __ge_p3_dbl(ge_p1p1_t *r, const ge_p3_t *p){
+	ge_p2_t q;
+	__ge_p3_to_p2(&q, p);
+	__ge_p2_dbl(r, &q);
+}
+
+void __ge_add(ge_p1p1_t *r, const ge_p3_t *p, const ge_cached_t *q){
+	fe_t t0;
+	__fe_add(&r->X, &p->Y, &p->X);
+	__fe_sub(&r->Y, &p->Y, &p->X);
+	__fe_mul(&r->Z, &r->X, &q->YplusX);
+	__fe_mul(&r->Y, &r->Y, &q->YminusX);
+	__fe_mul(&r->T, &q->T2d, &p->T);
+	__fe_mul(&r->X, &p->Z, &q->Z);
+	__fe_add(&t0, &r->X, &r->X);
+	__fe_sub(&r->X, &r->Z, &r->Y);
+	__fe_add(&r->Y, &r->Z, &r->Y);
+	__fe_add(&r->Z, &t0, &r->T);
+	__fe_sub(&r->T, &t0, &r->T);
+}
+
+void __ge_sub(ge_p1p1_t *r, const ge_p3_t *p, const ge_cached_t *q){
+	fe_t t0;
+	__fe_add(&r->X, &p->Y, &p->X);
+	__fe_sub(&r->Y, &p->Y, &p->X);
+	__fe_mul(&r->Z, &r->X, &q->YminusX);
+	__fe_mul(&r->Y, &r->Y, &q->YplusX);
+	__fe_mul(&r->T, &q->T2d, &p->T);
+	__fe_mul(&r->X, &p->Z, &q->Z);
+	__fe_add(&t0, &r->X, &r->X);
+	__fe_sub(&r->X, &r->Z, &r->Y);
+	__fe_add(&r->Y, &r->Z, &r->Y);
+	__fe_sub(&r->Z, &t0, &r->T);
+	__fe_add(&r->T, &t0, &r->T);
+}
+
+void __ge_madd(ge_p1p1_t *r, const ge_p3_t *p, const ge_precomp_t *q){
+	fe_t t0;
+	__fe_add(&r->X, &p->Y, &p->X);
+	__fe_sub(&r->Y, &p->Y, &p->X);
+	__fe_mul(&r->Z, &r->X, &q->yplusx);
+	__fe_mul(&r->Y, &r->Y, &q->yminusx);
+	__fe_mul(&r->T, &q->xy2d, &p->T);
+	__fe_add(&t0, &p->Z, &p->Z);
+	__fe_sub(&r->X, &r->Z, &r->Y);
+	__fe_add(&r->Y, &r->Z, &r->Y);
+	__fe_add(&r->Z, &t0, &r->T);
+	__fe_sub(&r->T, &t0, &r->T);
+}
+
+void __ge_msub(ge_p1p1_t *r, const ge_p3_t *p, const ge_precomp_t *q){
+	fe_t t0;
+	__fe_add(&r->X, &p->Y, &p->X);
+	__fe_sub(&r->Y, &p->Y, &p->X);
+	__fe_mul(&r->Z, &r->X, &q->yminusx);
+	__fe_mul(&r->Y, &r->Y, &q->yplusx);
+	__fe_mul(&r->T, &q->xy2d, &p->T);
+	__fe_add(&t0, &p->Z, &p->Z);
+	__fe_sub(&r->X, &r->Z, &r->Y);
+	__fe_add(&r->Y, &r->Z, &r->Y);
+	__fe_sub(&r->Z, &t0, &r->T);
+	__fe_add(&r->T, &t0, &r->T);
+}
+
+//--------------------------ristretto255 codec
+int __ge_frombytes(ge_p3_t *h, const uint8_t *s){
+	fe_t sf, ss, u1, u2, u2sq, v, t, invsqrt, denx, deny;
+	uint8_t chk[32]; int sq;
+
+	__fe_frombytes(&sf, s);
+	__fe_tobytes(chk, &sf);
+	if( memcmp(chk, s, 32) != 0 || (s[0] & 1) ) return -1; //not canonical or negative
+
+	__fe_sq(&ss, &sf);
+	__fe_1(&t);
+	__fe_sub(&u1, &t, &ss); // 1 - s^2
+	__fe_add(&u2, &t, &ss); // 1 + s^2
+	__fe_sq(&u2sq, &u2);
+
+	__fe_sq(&v, &u1);
+	__fe_mul(&v, &v, &__fe_d);
+	__fe_neg(&v, &v);
+	__fe_sub(&v, &v, &u2sq); // -(d u1^2) - u2^2
+
+	__fe_mul(&u2sq, &v, &u2sq);
+	sq = __fe_sqrt_ratio_m1(&invsqrt, &t, &u2sq);
+
+	__fe_mul(&denx, &invsqrt, &u2);
+	__fe_mul(&deny, &invsqrt, &denx);
+	__fe_mul(&deny, &deny, &v);
+
+	__fe_mul(&h->X, &sf, &denx);
+	__fe_add(&h->X, &h->X, &h->X);
+	__fe_abs(&h->X, &h->X);
+	__fe_mul(&h->Y, &u1, &deny);
+	__fe_1(&h->Z);
+	__fe_mul(&h->T, &h->X, &h->Y);
+
+	if( !sq || __fe_isnegative(&h->T) || __fe_iszero(&h->Y) ) return -1;
+	return 0;
+}
+
+void __ge_tobytes(uint8_t *s, const ge_p3_t *h){
+	fe_t u1, u2, t, invsqrt, den1, den2, zinv, ix, iy, eden, x, y, deninv;
+	int rotate;
+
+	__fe_add(&u1, &h->Z, &h->Y);
+	__fe_sub(&t, &h->Z, &h->Y);
+	__fe_mul(&u1, &u1, &t); // (Z+Y)(Z-Y)
+	__fe_mul(&u2, &h->X, &h->Y);
+
+	__fe_sq(&t, &u2);
+	__fe_mul(&t, &t, &u1);
+	__fe_1(&x);
+	__fe_sqrt_ratio_m1(&invsqrt, &x, &t);
+
+	__fe_mul(&den1, &invsqrt, &u1);
+	__fe_mul(&den2, &invsqrt, &u2);
+	__fe_mul(&zinv, &den1, &den2);
+	__fe_mul(&zinv, &zinv, &h->T);
+
+	__fe_mul(&ix, &h->X, &__fe_sqrtm1);
+	__fe_mul(&iy, &h->Y, &__fe_sqrtm1);
+	__fe_mul(&eden, &den1, &__fe_invsqrt_a_minus_d);
+
+	__fe_mul(&t, &h->T, &zinv);
+	rotate = __fe_isnegative(&t);
+
+	__fe_copy(&x, &h->X);
+	__fe_copy(&y, &h->Y);
+	__fe_cmov(&x, &iy, rotate);
+	__fe_cmov(&y, &ix, rotate);
+	__fe_copy(&deninv, &den2);
+	__fe_cmov(&deninv, &eden, rotate);
+
+	__fe_mul(&t, &x, &zinv);
+	__fe_cneg(&y, __fe_isnegative(&t));
+
+	__fe_sub(&t, &h->Z, &y);
+	__fe_mul(&t, &deninv, &t);
+	__fe_abs(&t, &t);
+	__fe_tobytes(s, &t);
+}
+
+// per point state of the batch encoder
+struct __ge_dblenc {
+	fe_t e, f, g, h, eg, fh, acc;
+	unsigned int z; //2p is the identity
+};
+
+int __ge_dbl_tobytes_n(uint8_t *s, const ge_p3_t *p, size_t n){
+	struct __ge_dblenc *st;
+	fe_t t, u, inv, zinv, tinv, magic, me, fs;
+	unsigned int c1, c2;
+
+	if( n == 0 ) return 0;
+	st = (struct __ge_dblenc *)malloc( n*sizeof(struct __ge_dblenc) );
+	if( st == NULL ) return -1;
+
+	for(size_t i=0;i<n;i++){
+		struct __ge_dblenc *q = &st[i];
+		fe_t xx, yy, zz, dtt, efgh;
+		__fe_sq(&xx, &p[i].X);
+		__fe_sq(&yy, &p[i].Y);
+		__fe_sq(&zz, &p[i].Z);
+		__fe_sq(&dtt, &p[i].T);
+		__fe_mul(&dtt, &dtt, &__fe_d);
+		__fe_add(&t, &p[i].Y, &p[i].Y);
+		__fe_mul(&q->e, &p[i].X, &t); // 2XY
+		__fe_add(&q->f, &zz, &dtt);
+		__fe_add(&q->g, &yy, &xx);
+		__fe_sub(&q->h, &zz, &dtt);
+		__fe_mul(&q->eg, &q->e, &q->g);
+		__fe_mul(&q->fh, &q->f, &q->h);
+		__fe_mul(&efgh, &q->eg, &q->fh);
+		// a zero factor (2p = identity) must not spoil the shared inversion
+		q->z = __fe_iszero(&efgh);
+		__fe_1(&t);
+		__fe_cmov(&efgh, &t, q->z);
+		if( i > 0 ){
+			__fe_mul(&q->acc, &st[i-1].acc, &efgh);
+		}else{
+			__fe_copy(&q->acc, &efgh);
+		}
+	}
+
+	__fe_invert(&inv, &st[n-1].acc);
+	for(size_t i=n;i-->0;){
+		struct __ge_dblenc *q = &st[i];
+		// u = 1/efgh_i, inv moves on to 1/(efgh_0 ... efgh_i-1)
+		if( i > 0 ){
+			__fe_mul(&u, &inv, &st[i-1].acc);
+			__fe_mul(&t, &q->eg, &q->fh);
+			__fe_1(&fs);
+			__fe_cmov(&t, &fs, q->z);
+			__fe_mul(&inv, &inv, &t);
+		}else{
+			__fe_copy(&u, &inv);
+		}
+		__fe_mul(&zinv, &q->eg, &u);
+		__fe_mul(&tinv, &q->fh, &u);
+
+		__fe_mul(&t, &q->eg, &zinv);
+		c1 = __fe_isnegative(&t);
+		__fe_neg(&me, &q->e);
+		__fe_mul(&fs, &q->f, &__fe_sqrtm1);
+		__fe_copy(&magic, &__fe_invsqrt_a_minus_d);
+		__fe_cmov(&q->e, &q->g, c1);
+		__fe_cmov(&q->g, &me, c1);
+		__fe_cmov(&q->h, &fs, c1);
+		__fe_cmov(&magic, &__fe_sqrtm1, c1);
+
+		__fe_mul(&t, &q->h, &q->e);
+		__fe_mul(&t, &t, &zinv);
+		c2 = __fe_isnegative(&t);
+		__fe_cneg(&q->g, c2);
+
+		__fe_mul(&t, &q->g, &tinv);
+		__fe_mul(&t, &magic, &t);
+		__fe_sub(&u, &q->h, &q->g);
+		__fe_mul(&t, &u, &t);
+		__fe_abs(&t, &t);
+		__fe_0(&u);
+		__fe_cmov(&t, &u, q->z);
+		__fe_tobytes(s + 32*i, &t);
+	}
+
+	free(st);
+	return 0;
+}
+
+// ristretto255 points are equal to the identity iff X = 0 or Y = 0
+int __ge_is_identity(const ge_p3_t *h){
+	return __fe_iszero(&h->X) | __fe_iszero(&h->Y);
+}
+
+// same coset iff X1Y2 = Y1X2 or Y1Y2 = X1X2
+int __ge_eq(const ge_p3_t *p, const ge_p3_t *q){
+	fe_t a, b;
+	int r;
+	__fe_mul(&a, &p->X, &q->Y);
+	__fe_mul(&b, &p->Y, &q->X);
+	r = __fe_eq(&a, &b);
+	__fe_mul(&a, &p->Y, &q->Y);
+	__fe_mul(&b, &p->X, &q->X);
+	return r | __fe_eq(&a, &b);
+}
+
+void __ge_p3_add(ge_p3_t *r, const ge_p3_t *p, const ge_p3_t *q){
+	ge_cached_t c;
+	ge_p1p1_t t;
+	__ge_p3_to_cached(&c, q);
+	__ge_add(&t, p, &c);
+	__ge_p1p1_to_p3(r, &t);
+}
+
+void __ge_p3_sub(ge_p3_t *r, const ge_p3_t *p, const ge_p3_t *q){
+	ge_cached_t c;
+	ge_p1p1_t t;
+	__ge_p3_to_cached(&c, q);
+	__ge_sub(&t, p, &c);
+	__ge_p1p1_to_p3(r, &t);
+}
+
+void __ge_p3_neg(ge_p3_t *r, const ge_p3_t *p){
+	__fe_neg(&r->X, &p->X);
+	__fe_copy(&r->Y, &p->Y);
+	__fe_copy(&r->Z, &p->Z);
+	__fe_neg(&r->T, &p->T);
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <sodium.h>
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__ge4x.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+#define GE4X_TARGET __attribute__((target("avx2")))
+
+// limb k of four field elements, 26 bits for even k and 25 for odd k
+typedef struct __fex {
+	__m256i l[10];
+} fex_t;
+
+typedef struct __gex_p2 {
+	fex_t X, Y, Z;
+} gex_p2_t;
+
+typedef struct __gex_p3 {
+	fex_t X, Y, Z, T;
+} gex_p3_t;
+
+typedef struct __gex_p1p1 {
+	fex_t X, Y, Z, T;
+} gex_p1p1_t;
+
+typedef struct __gex_precomp {
+	fex_t yplusx, yminusx, xy2d;
+} gex_precomp_t;
+
+#define M26 ((1 << 26) - 1)
+#define M25 ((1 << 25) - 1)
+
+static GE4X_TARGET inline __m256i __fex_m19(__m256i x){
+	return _mm256_add_epi64(x, _mm256_add_epi64(_mm256_slli_epi64(x, 1), _mm256_slli_epi64(x, 4)));
+}
+
+// one parallel carry round, enough after an addition or subtraction
+static GE4X_TARGET inline void __fex_carry1(fex_t *h){
+	const __m256i m26 = _mm256_set1_epi64x(M26), m25 = _mm256_set1_epi64x(M25);
+	__m256i c[10];
+	for(int k=0;k<10;k++) c[k] = _mm256_srli_epi64(h->l[k], (k & 1) ? 25 : 26);
+	h->l[0] = _mm256_add_epi64(_mm256_and_si256(h->l[0], m26), __fex_m19(c[9]));
+	for(int k=1;k<10;k++) h->l[k] = _mm256_add_epi64(_mm256_and_si256(h->l[k], (k & 1) ? m25 : m26), c[k-1]);
+}
+
+#define FEX_CARRY(k) do{ \
+	const __m256i _c = _mm256_srli_epi64(h->l[k], ((k) & 1) ? 25 : 26); \
+	h->l[k] = _mm256_and_si256(h->l[k], ((k) & 1) ? m25 : m26); \
+	h->l[(k)+1] = _mm256_add_epi64(h->l[(k)+1], _c); \
+}while(0)
+
+// full carry after a product (two interleaved chains, as in ref10)
+static GE4X_TARGET inline void __fex_carry(fex_t *h){
+	const __m256i m26 = _mm256_set1_epi64x(M26), m25 = _mm256_set1_epi64x(M25);
+	__m256i c;
+	FEX_CARRY(0); FEX_CARRY(4);
+	FEX_CARRY(1); FEX_CARRY(5);
+	FEX_CARRY(2); FEX_CARRY(6);
+	FEX_CARRY(3); FEX_CARRY(7);
+	FEX_CARRY(4); FEX_CARRY(8);
+	c = _mm256_srli_epi64(h->l[9], 25);
+	h->l[9] = _mm256_and_si256(h->l[9], m25);
+	h->l[0] = _mm256_add_epi64(h->l[0], __fex_m19(c));
+	FEX_CARRY(0);
+}
+
+// the additive operations are lazy: limbs of carried inputs stay below
+// 2^28, which the product tolerates on either side (19 g < 2^32 and the
+// column sums < 2^64)
+static GE4X_TARGET inline void __fex_add(fex_t *h, const fex_t *f, const fex_t *g){
+	for(int k=0;k<10;k++) h->l[k] = _mm256_add_epi64(f->l[k], g->l[k]);
+}
+
+// h = f + 2p - g, g must be carried (or a product)
+static GE4X_TARGET inline void __fex_sub(fex_t *h, const fex_t *f, const fex_t *g){
+	const __m256i p0 = _mm256_set1_epi64x(0x7ffffda);
+	const __m256i pe = _mm256_set1_epi64x(0x7fffffe), po = _mm256_set1_epi64x(0x3fffffe);
+	h->l[0] = _mm256_sub_epi64(_mm256_add_epi64(f->l[0], p0), g->l[0]);
+	for(int k=1;k<10;k++) h->l[k] = _mm256_sub_epi64(_mm256_add_epi64(f->l[k], (k & 1) ? po : pe), g->l[k]);
+}
+
+// h = f * g, products of two odd limbs count twice and wrapped ones 19 times
+static GE4X_TARGET void __fex_mul(fex_t *h, const fex_t *f, const fex_t *g){
+	__m256i g19[10], f2[10], r[10];
+	for(int k=0;k<10;k++){
+		g19[k] = __fex_m19(g->l[k]);
+		f2[k] = (k & 1) ? _mm256_add_epi64(f->l[k], f->l[k]) : f->l[k];
+		r[k] = _mm256_setzero_si256();
+	}
+#pragma GCC unroll 10
+	for(int i=0;i<10;i++){
+#pragma GCC unroll 10
+		for(int j=0;j<10;j++){
+			const __m256i a = (j & 1) ? f2[i] : f->l[i];
+			const __m256i b = (i + j >= 10) ? g19[j] : g->l[j];
+			r[(i+j) % 10] = _mm256_add_epi64(r[(i+j) % 10], _mm256_mul_epu32(a, b));
+		}
+	}
+	for(int k=0;k<10;k++) h->l[k] = r[k];
+	__fex_carry(h);
+}
+
+// four lanes of one fe_t each, limbs split at bit 26
+static GE4X_TARGET void __fex_split(fex_t *h, const __m256i *v){
+	const __m256i m26 = _mm256_set1_epi64x(M26);
+	for(int k=0;k<5;k++){
+		h->l[2*k] = _mm256_and_si256(v[k], m26);
+		h->l[2*k+1] = _mm256_srli_epi64(v[k], 26);
+	}
+}
+
+static GE4X_TARGET void __fex_unpack(fe_t *h, const fex_t *f){
+	uint64_t lo[4], hi[4];
+	for(int k=0;k<5;k++){
+		_mm256_storeu_si256((__m256i *)lo, f->l[2*k]);
+		_mm256_storeu_si256((__m256i *)hi, f->l[2*k+1]);
+		for(int j=0;j<4;j++) h[j].v[k] = lo[j] + (hi[j] << 26);
+	}
+	for(int j=0;j<4;j++) __fe_carry(&h[j]);
+}
+
+static GE4X_TARGET void __gex_p1p1_to_p2(gex_p2_t *r, const gex_p1p1_t *p){
+	__fex_mul(&r->X, &p->X, &p->T);
+	__fex_mul(&r->Y, &p->Y, &p->Z);
+	__fex_mul(&r->Z, &p->Z, &p->T);
+}
+
+static GE4X_TARGET void __gex_p1p1_to_p3(gex_p3_t *r, const gex_p1p1_t *p){
+	__fex_mul(&r->X, &p->X, &p->T);
+	__fex_mul(&r->Y, &p->Y, &p->Z);
+	__fex_mul(&r->Z, &p->Z, &p->T);
+	__fex_mul(&r->T, &p->X, &p->Y);
+}
+
+static GE4X_TARGET void __gex_p2_dbl(gex_p1p1_t *r, const gex_p2_t *p){
+	fex_t t0;
+	__fex_mul(&r->X, &p->X, &p->X);
+	__fex_mul(&r->Z, &p->Y, &p->Y);
+	__fex_mul(&r->T, &p->Z, &p->Z);
+	__fex_add(&r->T, &r->T, &r->T);
+	__fex_add(&r->Y, &p->X, &p->Y);
+	__fex_mul(&t0, &r->Y, &r->Y);
+	__fex_add(&r->Y, &r->Z, &r->X);
+	__fex_carry1(&r->Y);
+	__fex_sub(&r->Z, &r->Z, &r->X);
+	__fex_carry1(&r->Z);
+	__fex_sub(&r->X, &t0, &r->Y);
+	__fex_sub(&r->T, &r->T, &r->Z);
+	__fex_carry1(&r->T);
+}
+
+// the only carry left is on T (up to 2^28 before it)
+static GE4X_TARGET void __gex_madd(gex_p1p1_t *r, const gex_p3_t *p, const gex_precomp_t *q){
+	fex_t t0;
+	__fex_add(&r->X, &p->Y, &p->X);
+	__fex_sub(&r->Y, &p->Y, &p->X);
+	__fex_mul(&r->Z, &r->X, &q->yplusx);
+	__fex_mul(&r->Y, &r->Y, &q->yminusx);
+	__fex_mul(&r->T, &q->xy2d, &p->T);
+	__fex_add(&t0, &p->Z, &p->Z);
+	__fex_sub(&r->X, &r->Z, &r->Y);
+	__fex_add(&r->Y, &r->Z, &r->Y);
+	__fex_add(&r->Z, &t0, &r->T);
+	__fex_sub(&r->T, &t0, &r->T);
+	__fex_carry1(&r->T);
+}
+
+// t = b_i row[|b_i|-1] with the sign applied in lane i, every entry is
+// touched (the lanes select through masks)
+static GE4X_TARGET void __gex_select(gex_precomp_t *t, const ge_precomp_t *row, const int8_t *b){
+	__m256i ypx[5], ymx[5], xyd[5], babs, bneg, m;
+	fex_t n;
+	int8_t a[4], s[4];
+
+	for(int j=0;j<4;j++){
+		s[j] = (int8_t)((uint8_t)b[j] >> 7);
+		a[j] = (int8_t)(b[j] - (((-s[j]) & b[j]) << 1));
+	}
+	babs = _mm256_set_epi64x(a[3], a[2], a[1], a[0]);
+	bneg = _mm256_sub_epi64(_mm256_setzero_si256(), _mm256_set_epi64x(s[3], s[2], s[1], s[0]));
+	for(int k=0;k<5;k++){
+		ypx[k] = ymx[k] = _mm256_set1_epi64x(k == 0);
+		xyd[k] = _mm256_setzero_si256();
+	}
+	for(int j=0;j<8;j++){
+		m = _mm256_cmpeq_epi64(babs, _mm256_set1_epi64x(j+1));
+		for(int k=0;k<5;k++){
+			ypx[k] = _mm256_blendv_epi8(ypx[k], _mm256_set1_epi64x((long long)row[j].yplusx.v[k]), m);
+			ymx[k] = _mm256_blendv_epi8(ymx[k], _mm256_set1_epi64x((long long)row[j].yminusx.v[k]), m);
+			xyd[k] = _mm256_blendv_epi8(xyd[k], _mm256_set1_epi64x((long long)row[j].xy2d.v[k]), m);
+		}
+	}
+	// -(y+x, y-x, 2dxy) = (y-x, y+x, -2dxy)
+	for(int k=0;k<5;k++){
+		const __m256i u = _mm256_blendv_epi8(ypx[k], ymx[k], bneg);
+		ymx[k] = _mm256_blendv_epi8(ymx[k], ypx[k], bneg);
+		ypx[k] = u;
+	}
+	__fex_split(&t->yplusx, ypx);
+	__fex_split(&t->yminusx, ymx);
+	__fex_split(&t->xy2d, xyd);
+	__fex_sub(&n, &(const fex_t){{ _mm256_setzero_si256() }}, &t->xy2d);
+	for(int k=0;k<10;k++) t->xy2d.l[k] = _mm256_blendv_epi8(t->xy2d.l[k], n.l[k], bneg);
+
+	sodium_memzero(a, sizeof(a));
+	sodium_memzero(s, sizeof(s));
+}
+
+int __ge4x_ok(void){
+	static int ok = -1;
+	if( ok < 0 ){
+		__builtin_cpu_init();
+		ok = __builtin_cpu_supports("avx2");
+	}
+	return ok;
+}
+
+// the comb of __fbase_smul, four scalars at a time
+GE4X_TARGET static void __ge4x_comb(ge_p3_t *h, const uint8_t *a, const ge_fbase_t *f){
+	int8_t e[64][4], carry;
+	gex_precomp_t t; gex_p1p1_t r; gex_p2_t s; gex_p3_t p;
+	fe_t o[4];
+
+	// signed radix 16, digits in [-8, 8]
+	for(int j=0;j<4;j++){
+		const uint8_t *aj = a + 32*j;
+		for(int i=0;i<32;i++){
+			e[2*i][j] = aj[i] & 15;
+			e[2*i+1][j] = (aj[i] >> 4) & 15;
+		}
+		carry = 0;
+		for(int i=0;i<63;i++){
+			e[i][j] += carry;
+			carry = (int8_t)((e[i][j] + 8) >> 4);
+			e[i][j] -= (int8_t)(carry << 4);
+		}
+		e[63][j] += carry;
+	}
+
+	memset(&p, 0, sizeof(p));
+	p.Y.l[0] = p.Z.l[0] = _mm256_set1_epi64x(1);
+	for(int i=1;i<64;i+=2){
+		__gex_select(&t, f->comb[i/2], e[i]);
+		__gex_madd(&r, &p, &t);
+		__gex_p1p1_to_p3(&p, &r);
+	}
+	s.X = p.X; s.Y = p.Y; s.Z = p.Z;
+	for(int k=0;k<4;k++){
+		__gex_p2_dbl(&r, &s);
+		if( k < 3 ) __gex_p1p1_to_p2(&s, &r);
+	}
+	__gex_p1p1_to_p3(&p, &r);
+	for(int i=0;i<64;i+=2){
+		__gex_select(&t, f->comb[i/2], e[i]);
+		__gex_madd(&r, &p, &t);
+		__gex_p1p1_to_p3(&p, &r);
+	}
+
+	__fex_unpack(o, &p.X);
+	for(int j=0;j<4;j++) h[j].X = o[j];
+	__fex_unpack(o, &p.Y);
+	for(int j=0;j<4;j++) h[j].Y = o[j];
+	__fex_unpack(o, &p.Z);
+	for(int j=0;j<4;j++) h[j].Z = o[j];
+	__fex_unpack(o, &p.T);
+	for(int j=0;j<4;j++) h[j].T = o[j];
+
+	sodium_memzero(e, sizeof(e));
+	sodium_memzero(&t, sizeof(t));
+	sodium_memzero(&r, sizeof(r));
+	sodium_memzero(&s, sizeof(s));
+	sodium_memzero(&p, sizeof(p));
+	sodium_memzero(o, sizeof(o));
+}
+
+void __ge4x_smul(ge_p3_t *h, const uint8_t *a, const ge_fbase_t *f){
+	if( __ge4x_ok() ){
+		__ge4x_comb(h, a, f);
+		return;
+	}
+	for(int j=0;j<4;j++) __fbase_smul(&h[j], a + 32*j, f);
+}
+
+#else
+
+int __ge4x_ok(void){
+	return 0;
+}
+
+void __ge4x_smul(ge_p3_t *h, const uint8_t *a, const ge_fbase_t *f){
+	for(int j=0;j<4;j++) __fbase_smul(&h[j], a + 32*j, f);
+}
+
+#endif
@@ -26,80 +26,99 @@
 #include "../utils/bufhelp.h"
 #include "../utils/debug.h"
 #include "__crypto.h"
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__sarena.h"
+#include "__msm.h"
+#include "__kcache.h"
+#include "__cpool.h"
+#include "__dcq.h"
 #include "ibi.h"
 #include "schnorr91.h"
 
 #define HENG04_CMTLEN (2*RRE)
 #define HENG04_CHALEN RRS
 #define HENG04_RESLEN RRS
+#define HENG04S_CHALEN 16 //heng04s, 128 bit challenges
 
-//prover and verifier protocol states
+//prover and verifier protocol states, one block each (the prover's from
+//the secret arena, the verifier's ends with the identity) or in caller
+//storage of stlen bytes (ext set, the verifier then points at the caller's id)
 struct __heng04_prvst {
-	uint8_t *s;
-	uint8_t *U; //precomputation
-	uint8_t *nonce;
-	uint8_t *mbuf;
-	size_t mlen;
+	uint8_t s[RRS];
+	uint8_t nonce[RRS];
+	uint8_t U[RRE]; //precomputation
+	uint8_t T[RRE]; //pooled commitment
+	int pooled; //T is set, 0 if no pooled commitment was ready
+	uint8_t ext; //caller storage, cleared instead of freed
 };
 
 struct __heng04_verst {
-	uint8_t *A;
-	uint8_t *c; //challenge
-	uint8_t *U; //precompute
-	uint8_t *NE; //commit nonce group element
-	uint8_t *mbuf;
+	uint8_t A[RRE];
+	uint8_t hid; //hash-to-scalar of the mpk
+	struct __ge_fbase *At; //NULL if the mpk was not prepared
+	uint8_t c[RRS]; //challenge
+	uint8_t U[RRE]; //precompute
+	uint8_t NE[RRE]; //commit nonce group element
+	int pre; //verpre: 0 not run, 1 done, 2 done on a cached K, -1 failed
+	kcache_t *kc; //key cache of the verifier's context
+	uint8_t kid[KCACHE_IDLEN];
+	ge_p3_t K; //U' - xA
+	ge_p3_t Q; //T + cK
+	uint8_t ext; //caller storage, cleared instead of freed
+	const uint8_t *m; //the identity, mbuf or the caller's
 	size_t mlen;
+	uint8_t mbuf[];
 };
 
+#define HENG04_STLEN (sizeof(struct __heng04_verst) > sizeof(struct __heng04_prvst) ? \
+		sizeof(struct __heng04_verst) : sizeof(struct __heng04_prvst))
+
 void __heng04_prvstfree(void *state){
 	struct __heng04_prvst *tmp = (struct __heng04_prvst *)state; //parse state
-	sodium_free(tmp->s);
-	sodium_free(tmp->nonce);
-	memset(tmp->U, 0, RRE);//clear and free
-	free(tmp->U);
-	//free(tmp->mbuf);
-	free(tmp);
+	if( tmp->ext ) sodium_memzero(tmp, sizeof(struct __heng04_prvst));
+	else __sarena_free(state); //zeroes s, the nonce and U
 }
 
 void __heng04_verstfree(void *state){
 	struct __heng04_verst *tmp = (struct __heng04_verst *)state; //parse state
-	free(tmp->A);
-	free(tmp->c);
-	free(tmp->U);
-	free(tmp->NE);
-	free(tmp->mbuf);
-	free(tmp);
+	__fbase_release(tmp->At);
+	if( !tmp->ext ) free(tmp);
 }
 
-// mbuf and mlen unused
-void __heng04_prvinit(void *vusk, const uint8_t *mbuf, size_t mlen, void **state){
-	struct __schnorr91_sg *usk = (struct __schnorr91_sg *)vusk;
-	struct __heng04_prvst *tmp;
-	tmp = (struct __heng04_prvst *)malloc(sizeof(struct __heng04_prvst));
-
-	//allocate and copy for mbuf
-	//tmp->mbuf = (uint8_t *)malloc(mlen);
-	//tmp->mlen = mlen;
-	//memcpy(tmp->mbuf, mbuf, mlen);
-
+static void __heng04_prvload(struct __heng04_prvst *tmp, const struct __schnorr91_sg *usk, uint8_t ext){
 	//copy secrets, vusk no longer needed
-	tmp->s = (uint8_t *)sodium_malloc(RRS);
 	memcpy( tmp->s, usk->s, RRS);
-	tmp->U = (uint8_t *)malloc(RRE);
 	memcpy( tmp->U, usk->U, RRE); //x is not copied as it is not needed
 
+	//take a precomputed commitment if the key has a pool
+	tmp->pooled = (__cpool_pop(usk->cp, tmp->nonce, NULL, tmp->T) == 0);
+	tmp->ext = ext;
+}
+
+// mbuf and mlen unused
+void __heng04_prvinit(void *vusk, const uint8_t *mbuf, size_t mlen, void **state){
+	struct __heng04_prvst *tmp;
+	tmp = (struct __heng04_prvst *)__sarena_alloc(sizeof(struct __heng04_prvst));
+	__heng04_prvload(tmp, (struct __schnorr91_sg *)vusk, 0);
 	*state = (void *)tmp; //recast and return
 }
 
+void __heng04_prvinit_at(void *vusk, const uint8_t *mbuf, size_t mlen, void *state){
+	__heng04_prvload((struct __heng04_prvst *)state, (struct __schnorr91_sg *)vusk, 1);
+}
+
 //mbuf and mlen unused in this case, but generally it could be used
 void __heng04_cmtgen(void **state, uint8_t *cmt){
 	struct __heng04_prvst *tmp = (struct __heng04_prvst *)(*state); //parse state
 
 	uint8_t tbuf[RRE]; int rc;
-	tmp->nonce = (uint8_t *)sodium_malloc(RRS); //allocate nonce
-
-	crypto_core_ristretto255_scalar_random(tmp->nonce); //sample nonce and compute cmt
-	rc = crypto_scalarmult_ristretto255_base(tbuf , tmp->nonce);
+	if( tmp->pooled ){
+		memcpy(tbuf, tmp->T, RRE); //nonce came from the pool
+	}else{
+		__cb->scrand(tmp->nonce); //sample nonce and compute cmt
+		rc = __cb->ptbase(tbuf , tmp->nonce);
+	}
 	//create commit message
 	//*cmt = (uint8_t *)malloc(HENG04_CMTLEN); // leave it up to user to allocate
 	//commit = U, V = vB where v is nonce
@@ -114,66 +133,203 @@ void __heng04_resgen(const uint8_t *cha, void *state, uint8_t *res){
 	//*res = (uint8_t *)malloc(HENG04_RESLEN); //leave it up to user to allocate
 
 	//compute response : y=t+cs where t is nonce
-	crypto_core_ristretto255_scalar_mul( res, cha, tmp->s ); //
-	crypto_core_ristretto255_scalar_add( res, res, tmp->nonce );
+	__cb->scmul( res, cha, tmp->s ); //
+	__cb->scadd( res, res, tmp->nonce );
 	__heng04_prvstfree(state); //critical, PLEASE FREE BEFORE RETURNING
 }
 
-void __heng04_verinit(void *vpar, const uint8_t *mbuf, size_t mlen, void **state){
-	struct __schnorr91_pk *par = (struct __schnorr91_pk *)vpar; //parse mpk
-	struct __heng04_verst *tmp;
-	//allocate
-	tmp = (struct __heng04_verst *)malloc(sizeof(struct __heng04_verst));
+void __heng04s_resgen(const uint8_t *cha, void *state, uint8_t *res){
+	uint8_t c[RRS] = {0};
+	memcpy(c, cha, HENG04S_CHALEN);
+	__heng04_resgen(c, state, res);
+}
 
-	//copy mbuf
-	tmp->mbuf = (uint8_t *)malloc(mlen);
-	memcpy(tmp->mbuf, mbuf, mlen);
+// the challenge is independent of the commitment, so it is sampled here
+static void __heng04_verload(struct __heng04_verst *tmp, kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, size_t clen){
+	struct __schnorr91_pk *par = (struct __schnorr91_pk *)vpar; //parse mpk
+	tmp->kc = kc;
+	tmp->m = mbuf;
 	tmp->mlen = mlen;
 
 	//copy public params
-	tmp->A = (uint8_t *)malloc(RRE);
 	memcpy(tmp->A, par->A, RRE);
+	tmp->At = __fbase_dup(par->At);
+	tmp->hid = par->hid;
+	tmp->pre = 0;
+
+	//generate challenge
+	memset(tmp->c, 0, RRS);
+	if( clen == RRS ) __cb->scrand(tmp->c);
+	else __cb->randbytes(tmp->c, clen); //short challenge, zero extended
+}
 
+static void __heng04_verinit_l(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void **state, size_t clen){
+	struct __heng04_verst *tmp;
+	//allocate with room for mbuf
+	tmp = (struct __heng04_verst *)malloc(sizeof(struct __heng04_verst) + mlen);
+	memcpy(tmp->mbuf, mbuf, mlen);
+	__heng04_verload(tmp, kc, vpar, tmp->mbuf, mlen, clen);
+	tmp->ext = 0;
 	*state = (void *)tmp; //recast and return
 }
 
+void __heng04_verinit(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void **state){
+	__heng04_verinit_l(kc, vpar, mbuf, mlen, state, HENG04_CHALEN);
+}
+
+void __heng04s_verinit(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void **state){
+	__heng04_verinit_l(kc, vpar, mbuf, mlen, state, HENG04S_CHALEN);
+}
+
+//caller storage, mbuf is not copied and must outlive the session
+void __heng04_verinit_at(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void *state){
+	__heng04_verload((struct __heng04_verst *)state, kc, vpar, mbuf, mlen, HENG04_CHALEN);
+	((struct __heng04_verst *)state)->ext = 1;
+}
+
+void __heng04s_verinit_at(kcache_t *kc, void *vpar, const uint8_t *mbuf, size_t mlen, void *state){
+	__heng04_verload((struct __heng04_verst *)state, kc, vpar, mbuf, mlen, HENG04S_CHALEN);
+	((struct __heng04_verst *)state)->ext = 1;
+}
+
 //vpar unused, but generally it MAY be used
-void __heng04_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
+static void __heng04_chagen_l(const uint8_t *cmt, void **state, uint8_t *cha, size_t clen){
 	struct __heng04_verst *tmp = (struct __heng04_verst *)(*state); //parse state
 
-	tmp->U = (uint8_t *)malloc(RRE);
-	tmp->NE = (uint8_t *)malloc(RRE);
-
 	//parse commit
+	//commit = U', V = vB where v is nonce
 	skipcopy( tmp->U, cmt, 0, 	RRE);
 	skipcopy( tmp->NE, cmt, RRE, 	RRE);
 
-	//generate challenge
-	//commit = U', V = vB where v is nonce
-	tmp->c = (uint8_t *)malloc(RRS);
 	//*cha = (uint8_t *)malloc(HENG04_CHALEN); //leave it up to user to allocate
-	crypto_core_ristretto255_scalar_random(tmp->c);
-	memcpy(cha, tmp->c, RRS);
+	memcpy(cha, tmp->c, clen); //sampled by verinit
 
 	*state = (void *)tmp; //recast and return
 }
 
-//main decision function for protocol
-void __heng04_protdc(const uint8_t *res, void *state, int *dec){
+void __heng04_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
+	__heng04_chagen_l(cmt, state, cha, HENG04_CHALEN);
+}
+
+void __heng04s_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
+	__heng04_chagen_l(cmt, state, cha, HENG04S_CHALEN);
+}
+
+// K = U' - xA through the key cache, hit is set if it was cached
+static int __heng04_kget(struct __heng04_verst *tmp, ge_p3_t *K, int *hit){
+	__kcache_id(tmp->kid, KCACHE_TAG(0, tmp->hid), tmp->A, RRE, tmp->m, tmp->mlen, tmp->U);
+	*hit = (__kcache_get(tmp->kc, tmp->kid, K) == 0);
+	return *hit ? 0 : __kcache_kgen(K, tmp->A, tmp->At, tmp->U, tmp->m, tmp->mlen, tmp->hid);
+}
+
+// response independent part of protdc, to run after chagen while the
+// challenge and response are in flight. leaves protdc with yB == T + cK
+void __heng04_verpre(void *state){
 	struct __heng04_verst *tmp = (struct __heng04_verst *)(state); //parse state
+	ge_p3_t T, cK;
+	int hit = 0, rc;
 
-	uint8_t rhs[RRE]; uint8_t lhs[RRE]; uint8_t tbuf[RRS];
-	__sodium_2rinhashexec(tmp->mbuf, tmp->mlen, tmp->U, tmp->A, tbuf);
+	if( tmp->pre != 0 ) return; //already done
+	rc = __heng04_kget(tmp, &tmp->K, &hit);
+	if( rc == 0 ) rc = __ge_frombytes(&T, tmp->NE);
+	if( rc == 0 ) rc = __ge_scalarmult_vartime(&cK, tmp->c, &tmp->K);
+	if( rc == 0 ) __ge_p3_add(&tmp->Q, &T, &cK);
+	tmp->pre = (rc != 0) ? -1 : (hit ? 2 : 1);
+}
+
+// decision after verpre, a single base multiplication
+static void __heng04_protdc_pre(const uint8_t *res, struct __heng04_verst *tmp, int *dec){
+	uint8_t y[RRS];
+	ge_p3_t r;
+
+	*dec = (tmp->pre < 0) ? -1 : __fbase_init();
+	if( *dec == 0 ){
+		__msm_sc255(y, res);
+		__fbase_smul(&r, y, &__fbase_B);
+		if( !__ge_eq(&r, &tmp->Q) ) *dec = -1;
+	}
+	if( *dec == 0 && tmp->pre == 1 ) __kcache_put(tmp->kc, tmp->kid, &tmp->K);
+}
+
+//main decision function for protocol, clen is the challenge length
+static void __heng04_protdc_l(const uint8_t *res, void *state, int *dec, size_t clen){
+	struct __heng04_verst *tmp = (struct __heng04_verst *)(state); //parse state
 
-	// yB = T + c( U' - xP1 )
-	*dec = crypto_scalarmult_ristretto255_base(lhs, res); // yB
-	*dec += crypto_scalarmult_ristretto255( rhs, tbuf, tmp->A); // xA
-	*dec += crypto_core_ristretto255_sub( rhs, tmp->U, rhs); // U' - xA
-	*dec += crypto_scalarmult_ristretto255( rhs, tmp->c, rhs); // c( U' - xA )
-	*dec += crypto_core_ristretto255_add(rhs, tmp->NE, rhs);// T + c(U' - xA)
+	uint8_t y[RRS], nc[RRS], fsc[2*RRS] = {0};
+	const ge_fbase_t *fb[2];
+	ge_p3_t K, nK, T, r;
+	int hit;
+
+	if( tmp->pre != 0 ){
+		__heng04_protdc_pre(res, tmp, dec);
+		__heng04_verstfree(state);
+		return;
+	}
+
+	// yB = T + c( U' - xA ) = T + cK, K only depends on (mpk, id, U')
+	*dec = __heng04_kget(tmp, &K, &hit);
+	__msm_sc255(y, res);
+	if( *dec == 0 && clen == RRS ){
+		__cb->scneg(nc, tmp->c); // -c
+		*dec = __ge_double_scalarmult_vartime(&r, nc, &K, y);
+	}else if( *dec == 0 ){
+		// c < 2^128, so r = y0 B + y1 (2^128 B) + c(-K) with y = y0 + 2^128 y1
+		// has only half length scalars
+		fb[0] = &__fbase_B;
+		fb[1] = __fbase_hi(&__fbase_B);
+		memcpy(fsc, y, 16);
+		memcpy(fsc + RRS, y + 16, 16);
+		__ge_p3_neg(&nK, &K);
+		*dec = (fb[1] == NULL) ? -1 : __msm_vartime_fb(&r, fsc, fb, 2, tmp->c, &nK, 1);
+	}
+	if( *dec == 0 ){
+		*dec += __ge_frombytes(&T, tmp->NE);
+		if( *dec == 0 && !__ge_eq(&r, &T) ) *dec = -1; //compare unencoded
+	}
+	if( *dec == 0 && !hit ) __kcache_put(tmp->kc, tmp->kid, &K); //only cache keys that verified
 
 	__heng04_verstfree(state);
-	*dec += crypto_verify_32(lhs, rhs);
+}
+
+void __heng04_protdc(const uint8_t *res, void *state, int *dec){
+	__heng04_protdc_l(res, state, dec, HENG04_CHALEN);
+}
+
+void __heng04s_protdc(const uint8_t *res, void *state, int *dec){
+	__heng04_protdc_l(res, state, dec, HENG04S_CHALEN);
+}
+
+// yB = T + c(U' - xA) in deferred decision form, frees the state as protdc
+int __heng04_dcprep(const uint8_t *res, void *state, struct __ibi_dcent *e){
+	struct __heng04_verst *tmp = (struct __heng04_verst *)(state); //parse state
+	uint8_t x[RRS];
+	int rc;
+
+	rc = __ge_frombytes(&e->U, tmp->U);
+	rc += __ge_frombytes(&e->T, tmp->NE);
+	if( tmp->At != NULL ) e->A = tmp->At->P;
+	else rc += __ge_frombytes(&e->A, tmp->A);
+	if( rc == 0 ){
+		__h2s(tmp->hid, tmp->m, tmp->mlen, tmp->U, tmp->A, x);
+		memcpy(e->c, tmp->c, RRS); //short challenges are zero extended
+		__cb->scmul(e->cx, tmp->c, x);
+		__msm_sc255(e->y1, res);
+		memset(e->y2, 0, RRS);
+		memcpy(e->Ab, tmp->A, RRE);
+		e->At = __fbase_dup(tmp->At);
+		e->B2t = NULL;
+	}
+
+	__heng04_verstfree(state);
+	return (rc == 0) ? 0 : -1;
+}
+
+//start a commitment pool of n entries on a user key
+int __heng04_uprep(void *vusk, size_t n){
+	struct __schnorr91_sg *usk = (struct __schnorr91_sg *)vusk;
+	if( usk->cp != NULL ) return 0; //already prepared
+	usk->cp = __cpool_new(NULL, n);
+	return (usk->cp == NULL) ? -1 : 0;
 }
 
 const ibi_t heng04 = {
@@ -183,8 +339,73 @@ const ibi_t heng04 = {
 	.resgen = __heng04_resgen,
 	.verinit = __heng04_verinit,
 	.chagen = __heng04_chagen,
+	.verpre = __heng04_verpre,
+	.protdc = __heng04_protdc,
+	.uprep = __heng04_uprep,
+	.dcprep = __heng04_dcprep,
+	.prvinit_at = __heng04_prvinit_at,
+	.verinit_at = __heng04_verinit_at,
+	.cmtlen = HENG04_CMTLEN,
+	.chalen = HENG04_CHALEN,
+	.reslen = HENG04_RESLEN,
+	.stlen = HENG04_STLEN,
+};
+
+// heng04 with 128 bit challenges, the verifier runs half length scalars
+const ibi_t heng04s = {
+	.ds = (ds_t *)&schnorr91,
+	.prvinit = __heng04_prvinit, //proto
+	.cmtgen = __heng04_cmtgen,
+	.resgen = __heng04s_resgen,
+	.verinit = __heng04s_verinit,
+	.chagen = __heng04s_chagen,
+	.verpre = __heng04_verpre,
+	.protdc = __heng04s_protdc,
+	.uprep = __heng04_uprep,
+	.dcprep = __heng04_dcprep,
+	.prvinit_at = __heng04_prvinit_at,
+	.verinit_at = __heng04s_verinit_at,
+	.cmtlen = HENG04_CMTLEN,
+	.chalen = HENG04S_CHALEN,
+	.reslen = HENG04_RESLEN,
+	.stlen = HENG04_STLEN,
+};
+
+// BLAKE2b-512 hash-to-scalar, the protocol follows the key
+const ibi_t heng04b = {
+	.ds = (ds_t *)&schnorr91b,
+	.prvinit = __heng04_prvinit, //proto
+	.cmtgen = __heng04_cmtgen,
+	.resgen = __heng04_resgen,
+	.verinit = __heng04_verinit,
+	.chagen = __heng04_chagen,
+	.verpre = __heng04_verpre,
 	.protdc = __heng04_protdc,
+	.uprep = __heng04_uprep,
+	.dcprep = __heng04_dcprep,
+	.prvinit_at = __heng04_prvinit_at,
+	.verinit_at = __heng04_verinit_at,
 	.cmtlen = HENG04_CMTLEN,
 	.chalen = HENG04_CHALEN,
 	.reslen = HENG04_RESLEN,
+	.stlen = HENG04_STLEN,
+};
+
+const ibi_t heng04sb = {
+	.ds = (ds_t *)&schnorr91b,
+	.prvinit = __heng04_prvinit, //proto
+	.cmtgen = __heng04_cmtgen,
+	.resgen = __heng04s_resgen,
+	.verinit = __heng04s_verinit,
+	.chagen = __heng04s_chagen,
+	.verpre = __heng04_verpre,
+	.protdc = __heng04s_protdc,
+	.uprep = __heng04_uprep,
+	.dcprep = __heng04_dcprep,
+	.prvinit_at = __heng04_prvinit_at,
+	.verinit_at = __heng04s_verinit_at,
+	.cmtlen = HENG04_CMTLEN,
+	.chalen = HENG04S_CHALEN,
+	.reslen = HENG04_RESLEN,
+	.stlen = HENG04_STLEN,
 };
@@ -21,12 +21,17 @@
  */
 
 #include "ibi.h"
+#include "../core.h"
+#include "__dcq.h"
+#include "__par.h"
 #include "../utils/debug.h"
 #include "../utils/bufhelp.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 
+#define IBI_NALGO 10 //algorithms known to get_ibi_impl
+
 ibi_t *get_ibi_impl(uint8_t an){
 	switch(an){
 		case 0:
@@ -35,6 +40,20 @@ ibi_t *get_ibi_impl(uint8_t an){
 			return (ibi_t *) &chin15;
 		case 2:
 			return (ibi_t *) &vangujar19;
+		case 3:
+			return (ibi_t *) &heng04s;
+		case 4:
+			return (ibi_t *) &chin15s;
+		case 5:
+			return (ibi_t *) &heng04b;
+		case 6:
+			return (ibi_t *) &chin15b;
+		case 7:
+			return (ibi_t *) &vangujar19b;
+		case 8:
+			return (ibi_t *) &heng04sb;
+		case 9:
+			return (ibi_t *) &chin15sb;
 		default:
 			assert(0); //error
 			return (ibi_t *) &heng04;
@@ -49,6 +68,7 @@ int __ibi_ishier(uint8_t an){
 ibi_u_t *__ibi_uinit(uint8_t an, size_t mlen){
 	ibi_u_t *out = (ibi_u_t *)malloc(sizeof(ibi_u_t));
 	out->an = an;
+	out->v = 0;
 	out->mlen = mlen;
 	out->m = (uint8_t *)malloc(mlen);
 	return out;
@@ -58,6 +78,7 @@ void __ibi_ufree(void *in){
 	ibi_u_t *ri = (ibi_u_t *)in;
 	ds_t *impl = get_ibi_impl(ri->an)->ds;
 	impl->sgfree(ri->k);
+	if( ri->v ) return; //storage and id are the caller's
 	free(ri->m);
 	free(ri);
 }
@@ -75,6 +96,12 @@ void __ibi_uiread(void *in, uint8_t **out, size_t *len){
 	(*out)[*len] = 0; //null char
 }
 
+void __ibi_uiview(void *in, const uint8_t **out, size_t *len){
+	ibi_u_t *ri = (ibi_u_t *)in;
+	*len = ri->mlen;
+	*out = ri->m;
+}
+
 // base length of a user key (not including length of signature
 size_t __ibi_ukbslen(uint8_t an){
 	ds_t *impl = get_ibi_impl(an)->ds;
@@ -98,6 +125,31 @@ void __ibi_ukgen(
 	*out = (void *)uk;
 }
 
+// issue n user keys under the same master key
+void __ibi_ukgen_batch(
+	void *vkey,
+	const uint8_t **mbufs, const size_t *mlens,
+	size_t n, void **out
+){
+	ds_k_t *sk = (ds_k_t *)vkey;
+	ds_t *impl = get_ibi_impl(sk->an)->ds;
+	void **sgs;
+
+	if(impl->siggen_batch == NULL){
+		for(size_t i=0;i<n;i++) __ibi_ukgen(vkey, mbufs[i], mlens[i], &out[i]);
+		return;
+	}
+	sgs = (void **)malloc(n*sizeof(void *));
+	impl->siggen_batch(sk->k, mbufs, mlens, n, sgs);
+	for(size_t i=0;i<n;i++){
+		ibi_u_t *uk = __ibi_uinit(sk->an, mlens[i]);
+		uk->k = sgs[i];
+		memcpy(uk->m, mbufs[i], mlens[i]);
+		out[i] = (void *)uk;
+	}
+	free(sgs);
+}
+
 void __ibi_ukvrf(void *vpar, void *vusk, int *res){
 	ds_k_t *pk = (ds_k_t *)vpar;
 	ibi_u_t *uk = (ibi_u_t *)vusk;
@@ -106,6 +158,47 @@ void __ibi_ukvrf(void *vpar, void *vusk, int *res){
 	impl->sigvrf(pk->k, uk->k, uk->m, uk->mlen, res);
 }
 
+// validate n user keys issued under the same master key
+void __ibi_ukvrf_batch(void *vpar, void **vusks, size_t n, int *res){
+	ds_k_t *pk = (ds_k_t *)vpar;
+	ds_t *impl = get_ibi_impl(pk->an)->ds;
+	void **ps = (void **)malloc(n*sizeof(void *));
+	void **ss = (void **)malloc(n*sizeof(void *));
+	const uint8_t **ms = (const uint8_t **)malloc(n*sizeof(uint8_t *));
+	size_t *ls = (size_t *)malloc(n*sizeof(size_t));
+	size_t *pos = (size_t *)malloc(n*sizeof(size_t));
+	int *rs = (int *)malloc(n*sizeof(int));
+	size_t c = 0;
+
+	if( !ps || !ss || !ms || !ls || !pos || !rs ){
+		//out of memory, one at a time
+		for(size_t i=0;i<n;i++) __ibi_ukvrf(vpar, vusks[i], &res[i]);
+		free(ps); free(ss); free(ms); free(ls);
+		free(pos); free(rs);
+		return;
+	}
+
+	for(size_t i=0;i<n;i++){
+		ibi_u_t *uk = (ibi_u_t *)vusks[i];
+		if(uk->an != pk->an){ res[i] = 1; continue; }
+		ps[c] = pk->k;
+		ss[c] = uk->k;
+		ms[c] = uk->m;
+		ls[c] = uk->mlen;
+		pos[c++] = i;
+	}
+
+	if(impl->sigvrf_batch){
+		impl->sigvrf_batch(ps, ss, ms, ls, c, rs);
+	}else{
+		for(size_t i=0;i<c;i++) impl->sigvrf(ps[i], ss[i], ms[i], ls[i], &rs[i]);
+	}
+	for(size_t i=0;i<c;i++) res[pos[i]] = rs[i];
+
+	free(ps); free(ss); free(ms); free(ls);
+	free(pos); free(rs);
+}
+
 void __ibi_uprint(void *in){
 	ibi_u_t *ri = (ibi_u_t *)in;
 	ds_t *impl = get_ibi_impl(ri->an)->ds;
@@ -131,17 +224,37 @@ size_t __ibi_uconstr(const uint8_t *in, size_t len, void **out){
 	ibi_u_t *ri = __ibi_uinit(in[0], ul);
 	ds_t *impl = get_ibi_impl(ri->an)->ds; //get ds impl
 	size_t rs = 1; //first byte read
-	rs += impl->sgconstr(in+rs, &(ri->k));
+	size_t kl = impl->sgconstr(in+rs, &(ri->k));
+	if( kl == 0 ){
+		//the key was rejected
+		free(ri->m);
+		free(ri);
+		*out = NULL;
+		return 0;
+	}
+	rs += kl;
 	rs = skipcopy(ri->m, in, rs, ri->mlen);
 	*out = (void *)ri;
 	return rs;
 }
 
+// a session in caller storage, the scheme state follows the header
+struct __ibi_protst_at {
+	ibi_protst_t h;
+	max_align_t st[];
+};
+
+size_t __ibi_stlen(uint8_t an){
+	ibi_t *impl = get_ibi_impl(an); //get algorithm
+	return sizeof(struct __ibi_protst_at) + impl->stlen;
+}
+
 void __ibi_prvinit(void *vuk, void **state){
 	ibi_u_t *uk = (ibi_u_t *)vuk;
 	ibi_t *impl = get_ibi_impl(uk->an);
-	ibi_protst_t *tmp = (ibi_protst_t *)malloc(sizeof(ibi_protst_t *));
+	ibi_protst_t *tmp = (ibi_protst_t *)malloc(sizeof(ibi_protst_t));
 	tmp->an = uk->an; //set algo type
+	tmp->ext = 0;
 	impl->prvinit(uk->k, uk->m, uk->mlen, &(tmp->st));
 	*state = (void *)tmp;
 }
@@ -157,18 +270,44 @@ void __ibi_resgen(const uint8_t *cha, void *state, uint8_t *res){
 	ibi_protst_t *tmp = (ibi_protst_t *)(state);
 	ibi_t *impl = get_ibi_impl(tmp->an);
 	impl->resgen(cha, (tmp->st), res);
-	free(tmp);
+	if( !tmp->ext ) free(tmp);
+}
+
+// key cache of a context, NULL for the process one
+static struct __kcache *__ibi_kc(const ghibc_ctx_t *ctx){
+	return (ctx != NULL) ? ctx->kc : NULL;
 }
 
-void __ibi_verinit(void *vpa, const uint8_t *mbuf, size_t mlen, void **state){
+void __ibi_verinit(const ghibc_ctx_t *ctx, void *vpa, const uint8_t *mbuf, size_t mlen, void **state){
 	ds_k_t *pk = (ds_k_t *)vpa;
 	ibi_t *impl = get_ibi_impl(pk->an);
-	ibi_protst_t *tmp = (ibi_protst_t *)malloc(sizeof(ibi_protst_t *));
+	ibi_protst_t *tmp = (ibi_protst_t *)malloc(sizeof(ibi_protst_t));
 	tmp->an = pk->an;
-	impl->verinit(pk->k, mbuf, mlen, &(tmp->st));
+	tmp->ext = 0;
+	impl->verinit(__ibi_kc(ctx), pk->k, mbuf, mlen, &(tmp->st));
 	*state = (void *)tmp;
 }
 
+void __ibi_prvinit_at(void *vuk, void *state){
+	ibi_u_t *uk = (ibi_u_t *)vuk;
+	ibi_t *impl = get_ibi_impl(uk->an);
+	struct __ibi_protst_at *tmp = (struct __ibi_protst_at *)state;
+	tmp->h.an = uk->an;
+	tmp->h.ext = 1;
+	tmp->h.st = (void *)tmp->st;
+	impl->prvinit_at(uk->k, uk->m, uk->mlen, tmp->h.st);
+}
+
+void __ibi_verinit_at(const ghibc_ctx_t *ctx, void *vpa, const uint8_t *mbuf, size_t mlen, void *state){
+	ds_k_t *pk = (ds_k_t *)vpa;
+	ibi_t *impl = get_ibi_impl(pk->an);
+	struct __ibi_protst_at *tmp = (struct __ibi_protst_at *)state;
+	tmp->h.an = pk->an;
+	tmp->h.ext = 1;
+	tmp->h.st = (void *)tmp->st;
+	impl->verinit_at(__ibi_kc(ctx), pk->k, mbuf, mlen, tmp->h.st);
+}
+
 void __ibi_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
 	ibi_protst_t *tmp = (ibi_protst_t *)(*state);
 	ibi_t *impl = get_ibi_impl(tmp->an);
@@ -176,11 +315,17 @@ void __ibi_chagen(const uint8_t *cmt, void **state, uint8_t *cha){
 	*state = (void *)tmp;
 }
 
+void __ibi_verpre(void *state){
+	ibi_protst_t *tmp = (ibi_protst_t *)(state);
+	ibi_t *impl = get_ibi_impl(tmp->an);
+	if( impl->verpre != NULL ) impl->verpre(tmp->st);
+}
+
 void __ibi_protdc(const uint8_t *res, void *state, int *d){
 	ibi_protst_t *tmp = (ibi_protst_t *)(state);
 	ibi_t *impl = get_ibi_impl(tmp->an);
 	impl->protdc(res, tmp->st, d);
-	free(tmp);
+	if( !tmp->ext ) free(tmp);
 }
 
 size_t __ibi_cmtlen(uint8_t an){
@@ -244,7 +389,7 @@ void __ibi_kfree(void *in){
 		//secret key
 		impl->skfree(tmp->k);
 	}
-	free(tmp);
+	if( !tmp->v ) free(tmp);
 }
 
 size_t __ibi_kconstr(const uint8_t *in, void **out){
@@ -272,6 +417,21 @@ void __ibi_kprint(void *in){
 	}
 }
 
+int __ibi_kprep(void *in){
+	ds_k_t *tmp = (ds_k_t *)in;
+	ds_t *impl = get_ibi_impl(tmp->an)->ds; //get algorithm
+	if( !tmp->t ) return -1; //public keys only
+	if( impl->pkprep == NULL ) return 0; //nothing to prepare
+	return impl->pkprep(tmp->k);
+}
+
+int __ibi_uprep(void *in, size_t n){
+	ibi_u_t *tmp = (ibi_u_t *)in;
+	ibi_t *impl = get_ibi_impl(tmp->an);
+	if( impl->uprep == NULL ) return 0; //nothing to prepare
+	return impl->uprep(tmp->k, n);
+}
+
 size_t __ibi_fqnread(void *in, uint8_t **fqn){
 	ds_s_t *tmp = (ds_s_t *)in;
 	ds_t *impl = get_ibi_impl(tmp->an)->ds;
@@ -283,17 +443,120 @@ size_t __ibi_fqnread(void *in, uint8_t **fqn){
 	return 0;
 }
 
+size_t __ibi_fqnview(void *in, const uint8_t **fqn){
+	ibi_u_t *tmp = (ibi_u_t *)in;
+	ds_t *impl = get_ibi_impl(tmp->an)->ds;
+	if( impl->fqnview ){
+		return impl->fqnview(tmp->k, fqn);
+	}
+	// not implemented
+	*fqn = NULL;
+	return 0;
+}
+
+// views over serialized keys, the scheme's key follows the header
+struct __ibi_kview {
+	ds_k_t h;
+	max_align_t k[];
+};
+
+struct __ibi_uview {
+	ibi_u_t h;
+	max_align_t k[];
+};
+
+size_t __ibi_vlen(uint8_t an){
+	ds_t *impl = get_ibi_impl(an)->ds;
+	size_t hl = sizeof(struct __ibi_kview);
+	if( sizeof(struct __ibi_uview) > hl ) hl = sizeof(struct __ibi_uview);
+	return hl + impl->vlen;
+}
+
+size_t __ibi_kview(const uint8_t *in, size_t len, void *out){
+	struct __ibi_kview *tmp = (struct __ibi_kview *)out;
+	ds_t *impl;
+	size_t rs;
+	if( len < 2 || in[0] >= IBI_NALGO || in[1] != 1 ) return 0; //public keys only
+	impl = get_ibi_impl(in[0])->ds;
+	rs = impl->pkview(in+2, len-2, (void *)tmp->k);
+	if( rs == 0 ) return 0;
+	tmp->h.an = in[0];
+	tmp->h.t = 1;
+	tmp->h.v = 1;
+	tmp->h.k = (void *)tmp->k;
+	return rs + 2;
+}
+
+size_t __ibi_uview(const uint8_t *in, size_t len, void *out){
+	struct __ibi_uview *tmp = (struct __ibi_uview *)out;
+	ds_t *impl;
+	size_t rs;
+	if( len < 1 || in[0] >= IBI_NALGO ) return 0;
+	impl = get_ibi_impl(in[0])->ds;
+	rs = impl->sgview(in+1, len-1, (void *)tmp->k);
+	if( rs == 0 ) return 0;
+	rs += 1; //first byte read
+	tmp->h.an = in[0];
+	tmp->h.v = 1;
+	tmp->h.k = (void *)tmp->k;
+	tmp->h.m = (uint8_t *)(in + rs); //the id is the rest
+	tmp->h.mlen = len - rs;
+	return len;
+}
+
+void *__ibi_dcqinit(size_t n, unsigned long lat){
+	return (void *)__dcq_new(n, lat);
+}
+
+void __ibi_dcqpush(void *q, const uint8_t *res, void *state, void (*cb)(void *, int), void *arg){
+	ibi_protst_t *tmp = (ibi_protst_t *)(state);
+	ibi_t *impl = get_ibi_impl(tmp->an);
+	struct __ibi_dcent e;
+	int d;
+	if( impl->dcprep == NULL ){
+		impl->protdc(res, tmp->st, &d); //no batched form
+	}else{
+		d = impl->dcprep(res, tmp->st, &e);
+	}
+	if( !tmp->ext ) free(tmp);
+	if( impl->dcprep == NULL || d != 0 ){
+		cb(arg, d);
+		return;
+	}
+	e.cb = cb;
+	e.arg = arg;
+	__dcq_push((dcq_t *)q, &e);
+}
+
+void __ibi_dcqflush(void *q){
+	__dcq_flush((dcq_t *)q);
+}
+
+int __ibi_parinit(size_t n){
+	return __par_start(n);
+}
+
+void __ibi_dcqfree(void *q){
+	__dcq_free((dcq_t *)q);
+}
+
 const ibi_if_t ibi = {
 	.setup = __ibi_keygen,
 	.issue = __ibi_ukgen,
+	.issue_batch = __ibi_ukgen_batch,
 	.validate = __ibi_ukvrf,
+	.validate_batch = __ibi_ukvrf_batch,
 
 	.prvinit = __ibi_prvinit,
 	.cmtgen = __ibi_cmtgen,
 	.chagen = __ibi_chagen,
 	.verinit = __ibi_verinit,
 	.resgen = __ibi_resgen,
+	.verpre = __ibi_verpre,
 	.protdc = __ibi_protdc,
+	.stlen = __ibi_stlen,
+	.prvinit_at = __ibi_prvinit_at,
+	.verinit_at = __ibi_verinit_at,
 
 	.kfree = __ibi_kfree,
 	.ufree = __ibi_ufree,
@@ -315,5 +578,17 @@ const ibi_if_t ibi = {
 	.kprint = __ibi_kprint,
 	.uprint = __ibi_uprint,
 	.fqnread = __ibi_fqnread,
+	.vlen = __ibi_vlen,
+	.kview = __ibi_kview,
+	.uview = __ibi_uview,
+	.uiview = __ibi_uiview,
+	.fqnview = __ibi_fqnview,
 	.ishier = __ibi_ishier,
+	.kprep = __ibi_kprep,
+	.uprep = __ibi_uprep,
+	.parinit = __ibi_parinit,
+	.dcqinit = __ibi_dcqinit,
+	.dcqpush = __ibi_dcqpush,
+	.dcqflush = __ibi_dcqflush,
+	.dcqfree = __ibi_dcqfree,
 };
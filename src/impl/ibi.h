@@ -29,6 +29,7 @@
 
 typedef struct __ibi_u {
 	uint8_t an; //algo type
+	uint8_t v; //view over a serialized key, see ibi_if_t.uview
 	void *k; //key pointer
 	size_t mlen;
 	uint8_t *m; //user id
@@ -36,9 +37,14 @@ typedef struct __ibi_u {
 
 typedef struct __ibi_protst {
 	uint8_t an; //algo type
+	uint8_t ext; //caller storage, see ibi_if_t.stlen
 	void *st; //protocol state
 } ibi_protst_t;
 
+struct __ibi_dcent; //deferred decision entry, see __dcq.h
+struct __kcache; //verifier key cache, see __kcache.h
+struct __core; //library context, see core.h
+
 // ibi from kurosawa-heng transforms (DS+HVZK)
 typedef struct __ibi {
 	ds_t *ds;
@@ -49,33 +55,70 @@ typedef struct __ibi {
 	void (*cmtgen)(void **, uint8_t *);
 	void (*resgen)(const uint8_t *, void *, uint8_t *);
 
-	//used by verifier
-	void (*verinit)(void *, const uint8_t *, size_t, void **);
+	//used by verifier, K = U - xA goes through the given cache
+	void (*verinit)(struct __kcache *, void *, const uint8_t *, size_t, void **);
 	void (*chagen)(const uint8_t *, void **, uint8_t *);
 	void (*protdc)(const uint8_t *, void *, int *);
 
+	//optional, precomputes the response independent part of protdc
+	void (*verpre)(void *);
+	//optional, start a pool of n precomputed commitments on a user key
+	int (*uprep)(void *, size_t);
+	//optional, decodes a transcript for a deferred decision (see __dcq.h)
+	//and frees the state as protdc does, 0 on success
+	int (*dcprep)(const uint8_t *, void *, struct __ibi_dcent *);
+	//prvinit and verinit into caller storage of stlen bytes, the state is
+	//then cleared instead of freed and the verifier does not copy mbuf
+	void (*prvinit_at)(void *, const uint8_t *, size_t, void *);
+	void (*verinit_at)(struct __kcache *, void *, const uint8_t *, size_t, void *);
+
 	const size_t cmtlen;
 	const size_t chalen;
 	const size_t reslen;
+	const size_t stlen; //the larger of the prover and verifier states
 } ibi_t;
 
 extern const ibi_t heng04;
 extern const ibi_t chin15;
 extern const ibi_t vangujar19;
+extern const ibi_t heng04s; //heng04 with 128 bit challenges
+extern const ibi_t chin15s; //chin15 with 128 bit challenges
+// the above with BLAKE2b-512 as hash-to-scalar
+extern const ibi_t heng04b;
+extern const ibi_t chin15b;
+extern const ibi_t vangujar19b;
+extern const ibi_t heng04sb;
+extern const ibi_t chin15sb;
 
 typedef struct __ibi_if {
 	void (*setup)(uint8_t, void **, void **); //generate a ds_k_t sk and pk (setup)
 	void (*issue)( void *, const uint8_t *, size_t, void ** ); //issue new user key
+	void (*issue_batch)( void *, const uint8_t **, const size_t *, size_t, void ** ); //issue n user keys
 	void (*validate)(void *, void *, int *); //validate user key
+	void (*validate_batch)(void *, void **, size_t, int *); //validate n user keys
 
 	//generates a state information
 	void (*prvinit)(void *, void **);
 	void (*cmtgen)(void **, uint8_t *);
 	void (*resgen)(const uint8_t *, void *, uint8_t *);
-	//used by verifier
-	void (*verinit)(void *, const uint8_t *, size_t, void **);
+	//used by verifier. a session caches K = U - xA in the key cache of the
+	//context it was started on (NULL: the process context), the later calls
+	//reach it through the state
+	void (*verinit)(const struct __core *, void *, const uint8_t *, size_t, void **);
 	void (*chagen)(const uint8_t *, void **, uint8_t *);
+	//optional step between chagen and protdc, e.g. while the challenge and
+	//response are in flight: everything that does not depend on the response
+	//is done here and protdc is left with a base multiplication and compare
+	void (*verpre)(void *);
 	void (*protdc)(const uint8_t *, void *, int *);
+	//sessions in caller storage for servers that keep them in preallocated
+	//arrays: prvinit_at/verinit_at take stlen(an) bytes (max_align_t aligned)
+	//in place of the state pointer, and the rest of the calls are the same.
+	//nothing is allocated, resgen/protdc/dcqpush clear the storage instead of
+	//freeing it. the verifier reads the id from mbuf, which must outlive it
+	size_t (*stlen)(uint8_t);
+	void (*prvinit_at)(void *, void *);
+	void (*verinit_at)(const struct __core *, void *, const uint8_t *, size_t, void *);
 
 	void (*kfree)(void *); //free a sk/pk
 	void (*ufree)(void *); //free a user key
@@ -86,7 +129,7 @@ typedef struct __ibi_if {
 	size_t (*kserial)(void *, uint8_t *, size_t);
 	size_t (*userial)(void *, uint8_t *, size_t);
 	size_t (*kconstr)(const uint8_t *, void **);
-	size_t (*uconstr)(const uint8_t *, size_t, void **);
+	size_t (*uconstr)(const uint8_t *, size_t, void **); //0 and NULL if the key is rejected
 
 	size_t (*pklen)(uint8_t);
 	size_t (*sklen)(uint8_t);
@@ -97,7 +140,40 @@ typedef struct __ibi_if {
 	size_t (*chalen)(uint8_t);
 	size_t (*reslen)(uint8_t);
 	size_t (*fqnread)(void *, uint8_t **);
+	//read-only views over serialized keys (an mmap'd key store, a received
+	//buffer): kview (public keys only) and uview parse len bytes into vlen(an)
+	//bytes of caller storage (max_align_t aligned) and return what they used,
+	//0 if the input is malformed or short. fixed size fields are copied, the
+	//identity and hier name point into the input, which must outlive the view.
+	//a view takes a reference on the shared tables of its bases (built, under
+	//the registry lock, on the first key with that base), the prover's
+	//constant-time tables are built on first use instead.
+	//views go wherever keys do, kfree/ufree release them and leave the storage
+	size_t (*vlen)(uint8_t);
+	size_t (*kview)(const uint8_t *, size_t, void *);
+	size_t (*uview)(const uint8_t *, size_t, void *);
+	//the identity and hier name of a user key without copying (not terminated)
+	void (*uiview)(void *, const uint8_t **, size_t *);
+	size_t (*fqnview)(void *, const uint8_t **);
 	int (*ishier)(uint8_t);
+	//prepare a master public key for repeated verification (0 on success)
+	//the key is prepared in place and stays valid for validate/verinit
+	int (*kprep)(void *);
+	//precompute up to n commitments for a user key in the background (0 on success)
+	//prvinit takes from the pool and falls back to cmtgen sampling when it is empty
+	int (*uprep)(void *, size_t);
+	//latency mode for single sessions on big verifiers: n pinned helper threads
+	//take independent terms of every small verification equation (0 stops them)
+	int (*parinit)(size_t);
+	//deferred decisions for busy verifiers: (response, verifier state) pairs are
+	//queued and settled by one randomized check once n are pending or the oldest
+	//has waited lat us (0: only when full or flushed). cb(arg, dec) reports every
+	//session with dec as protdc would, possibly from the queue's own thread.
+	//schemes without a batched form are decided on push
+	void *(*dcqinit)(size_t, unsigned long);
+	void (*dcqpush)(void *, const uint8_t *, void *, void (*)(void *, int), void *);
+	void (*dcqflush)(void *);
+	void (*dcqfree)(void *); //decides what is still pending
 } ibi_if_t;
 
 extern const ibi_if_t ibi;
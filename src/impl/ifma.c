@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__msm.h"
+#include "__ifma.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+#define IFMA_TARGET __attribute__((target("avx2,avx512vl,avx512ifma")))
+
+// lane masks for _mm256_blend_epi32 (64 bit lanes 0..3)
+#define L0 0x03
+#define L1 0x0c
+#define L2 0x30
+#define L3 0xc0
+
+// four field elements, limb k of every lane in l[k]. the limbs are kept
+// below 2^52 (the multiplier input width) by a carry before each product
+typedef struct __fe4 {
+	__m256i l[5];
+} fe4_t;
+
+#define FE4_PERM(h, f, i0, i1, i2, i3) \
+	for(int _k=0;_k<5;_k++) (h)->l[_k] = _mm256_permute4x64_epi64((f)->l[_k], (i0)|((i1)<<2)|((i2)<<4)|((i3)<<6))
+#define FE4_BLEND(h, f, g, m) \
+	for(int _k=0;_k<5;_k++) (h)->l[_k] = _mm256_blend_epi32((f)->l[_k], (g)->l[_k], m)
+
+static IFMA_TARGET inline __m256i __fe4_m19(__m256i x){
+	return _mm256_add_epi64(x, _mm256_add_epi64(_mm256_slli_epi64(x, 1), _mm256_slli_epi64(x, 4)));
+}
+
+// one parallel carry round, limbs < 2^63 end up < 2^51 + 2^17
+static IFMA_TARGET inline void __fe4_carry(fe4_t *h){
+	const __m256i m = _mm256_set1_epi64x(FE_MASK51);
+	const __m256i c0 = _mm256_srli_epi64(h->l[0], 51);
+	const __m256i c1 = _mm256_srli_epi64(h->l[1], 51);
+	const __m256i c2 = _mm256_srli_epi64(h->l[2], 51);
+	const __m256i c3 = _mm256_srli_epi64(h->l[3], 51);
+	const __m256i c4 = _mm256_srli_epi64(h->l[4], 51);
+	h->l[0] = _mm256_add_epi64(_mm256_and_si256(h->l[0], m), __fe4_m19(c4));
+	h->l[1] = _mm256_add_epi64(_mm256_and_si256(h->l[1], m), c0);
+	h->l[2] = _mm256_add_epi64(_mm256_and_si256(h->l[2], m), c1);
+	h->l[3] = _mm256_add_epi64(_mm256_and_si256(h->l[3], m), c2);
+	h->l[4] = _mm256_add_epi64(_mm256_and_si256(h->l[4], m), c3);
+}
+
+// the additive operations are lazy, callers carry before a multiplication
+static IFMA_TARGET inline void __fe4_add(fe4_t *h, const fe4_t *f, const fe4_t *g){
+	for(int k=0;k<5;k++) h->l[k] = _mm256_add_epi64(f->l[k], g->l[k]);
+}
+
+// h = f + 2^(s+1) p - g, the bias has to cover the limbs of g
+static IFMA_TARGET inline void __fe4_sub(fe4_t *h, const fe4_t *f, const fe4_t *g, int s){
+	const __m256i p0 = _mm256_slli_epi64(_mm256_set1_epi64x(0xfffffffffffda), s);
+	const __m256i p1 = _mm256_slli_epi64(_mm256_set1_epi64x(0xffffffffffffe), s);
+	h->l[0] = _mm256_sub_epi64(_mm256_add_epi64(f->l[0], p0), g->l[0]);
+	for(int k=1;k<5;k++) h->l[k] = _mm256_sub_epi64(_mm256_add_epi64(f->l[k], p1), g->l[k]);
+}
+
+// a product limb splits into lo (weight 2^51k) and hi (weight 2^(51k+52),
+// counted twice at position k+1)
+#define FE4_MAC(i, j) \
+	z[(i)+(j)] = _mm256_madd52lo_epu64(z[(i)+(j)], f->l[i], g->l[j]); \
+	y[(i)+(j)+1] = _mm256_madd52hi_epu64(y[(i)+(j)+1], f->l[i], g->l[j]);
+#define FE4_ROW(i) FE4_MAC(i,0) FE4_MAC(i,1) FE4_MAC(i,2) FE4_MAC(i,3) FE4_MAC(i,4)
+
+// h = f * g, 4 lanes at once
+static IFMA_TARGET void __fe4_mul(fe4_t *h, const fe4_t *f, const fe4_t *g){
+	__m256i z[10], y[10];
+	for(int k=0;k<10;k++) z[k] = y[k] = _mm256_setzero_si256();
+	FE4_ROW(0) FE4_ROW(1) FE4_ROW(2) FE4_ROW(3) FE4_ROW(4)
+	for(int k=0;k<10;k++) z[k] = _mm256_add_epi64(z[k], _mm256_slli_epi64(y[k], 1));
+	// 2^255 = 19
+	for(int k=0;k<5;k++) h->l[k] = _mm256_add_epi64(z[k], __fe4_m19(z[k+5]));
+	__fe4_carry(h);
+}
+
+// lanes (Y-X, Y+X, Z, T) of an extended point
+static IFMA_TARGET void __ge4_prep(fe4_t *t, const fe4_t *p){
+	const fe4_t zero = {{ _mm256_setzero_si256() }};
+	fe4_t y, x, s, a;
+	FE4_PERM(&y, p, 1, 1, 2, 3);
+	FE4_PERM(&x, p, 0, 0, 0, 0);
+	FE4_BLEND(&x, &zero, &x, L0|L1);
+	__fe4_sub(&s, &y, &x, 0);
+	__fe4_add(&a, &y, &x);
+	FE4_BLEND(t, &s, &a, L1);
+	__fe4_carry(t);
+}
+
+// v = (E, H, F, G) to (EF, GH, FG, EH)
+static IFMA_TARGET void __ge4_out(fe4_t *r, const fe4_t *v){
+	fe4_t a, b;
+	FE4_PERM(&a, v, 0, 3, 2, 0);
+	FE4_PERM(&b, v, 2, 1, 3, 1);
+	__fe4_mul(r, &a, &b);
+}
+
+// r = p + q, q in the cached lanes (Y-X, Y+X, 2Z, 2dT)
+static IFMA_TARGET void __ge4_add(fe4_t *r, const fe4_t *p, const fe4_t *q){
+	fe4_t t, m, sw, u, w, d, s;
+	__ge4_prep(&t, p);
+	__fe4_mul(&m, &t, q); //(A, B, D, C)
+	FE4_PERM(&sw, &m, 1, 0, 3, 2);
+	FE4_BLEND(&u, &m, &sw, L0);
+	FE4_BLEND(&w, &sw, &m, L0);
+	__fe4_sub(&d, &u, &w, 0); //(B-A, ., D-C, .)
+	__fe4_add(&s, &m, &sw); //(., B+A, ., D+C)
+	FE4_BLEND(&t, &d, &s, L1|L3);
+	__fe4_carry(&t);
+	__ge4_out(r, &t);
+}
+
+// r = 2p, all four output coordinates are negated (same point)
+static IFMA_TARGET void __ge4_dbl(fe4_t *r, const fe4_t *p){
+	const fe4_t zero = {{ _mm256_setzero_si256() }};
+	fe4_t a, b, s, pos, neg;
+	FE4_PERM(&a, p, 0, 1, 2, 0);
+	FE4_PERM(&b, p, 1, 1, 1, 1);
+	FE4_BLEND(&b, &zero, &b, L3);
+	__fe4_add(&a, &a, &b); //(X, Y, Z, X+Y)
+	__fe4_carry(&a);
+	__fe4_mul(&s, &a, &a);
+	FE4_PERM(&pos, &s, 3, 0, 1, 1);
+	FE4_BLEND(&pos, &zero, &pos, L0|L2|L3); //(S4, 0, S2, S2)
+	FE4_PERM(&a, &s, 0, 0, 0, 0);
+	FE4_PERM(&b, &s, 1, 1, 2, 0);
+	FE4_BLEND(&b, &zero, &b, L0|L1|L2);
+	__fe4_add(&neg, &a, &b);
+	FE4_PERM(&b, &s, 2, 2, 2, 2);
+	FE4_BLEND(&b, &zero, &b, L2);
+	__fe4_add(&neg, &neg, &b); //(S1+S2, S1+S2, S1+2S3, S1), limbs < 2^54
+	__fe4_sub(&a, &pos, &neg, 2);
+	__fe4_carry(&a);
+	__ge4_out(r, &a);
+}
+
+// c[0] = cached(p), c[1] = cached(-p)
+static IFMA_TARGET void __ge4_cached(fe4_t *c, const fe4_t *p){
+	const fe4_t zero = {{ _mm256_setzero_si256() }};
+	fe4_t t, k, n;
+	__ge4_prep(&t, p);
+	for(int i=0;i<5;i++){
+		k.l[i] = _mm256_set_epi64x((long long)__fe_d2.v[i], (i == 0) ? 2 : 0, (i == 0), (i == 0));
+	}
+	__fe4_mul(&c[0], &t, &k);
+	FE4_PERM(&c[1], &c[0], 1, 0, 2, 3);
+	__fe4_sub(&n, &zero, &c[1], 0);
+	__fe4_carry(&n);
+	FE4_BLEND(&c[1], &c[1], &n, L3);
+}
+
+static IFMA_TARGET void __ge4_pack(fe4_t *h, const ge_p3_t *p){
+	for(int k=0;k<5;k++){
+		h->l[k] = _mm256_set_epi64x((long long)p->T.v[k], (long long)p->Z.v[k],
+				(long long)p->Y.v[k], (long long)p->X.v[k]);
+	}
+}
+
+static IFMA_TARGET void __ge4_unpack(ge_p3_t *p, const fe4_t *h){
+	uint64_t v[4];
+	for(int k=0;k<5;k++){
+		_mm256_storeu_si256((__m256i *)v, h->l[k]);
+		p->X.v[k] = v[0];
+		p->Y.v[k] = v[1];
+		p->Z.v[k] = v[2];
+		p->T.v[k] = v[3];
+	}
+}
+
+int __ifma_ok(void){
+	static int ok = -1;
+	if( ok < 0 ){
+		__builtin_cpu_init();
+		ok = __builtin_cpu_supports("avx512ifma") && __builtin_cpu_supports("avx512vl");
+	}
+	return ok;
+}
+
+IFMA_TARGET void *__ifma_tbl(const ge_cached_t *c, size_t cnt){
+	fe4_t *tbl;
+	if( !__ifma_ok() || posix_memalign((void **)&tbl, 32, 2*cnt*sizeof(fe4_t)) != 0 ) return NULL;
+	for(size_t i=0;i<cnt;i++){
+		ge_p3_t q; fe_t z2;
+		__fe_add(&z2, &c[i].Z, &c[i].Z);
+		// ge_cached_t lanes are (Y+X, Y-X, Z, 2dT)
+		q.X = c[i].YminusX; q.Y = c[i].YplusX; q.Z = z2; q.T = c[i].T2d;
+		__ge4_pack(&tbl[2*i], &q);
+		FE4_PERM(&tbl[2*i+1], &tbl[2*i], 1, 0, 2, 3);
+		{
+			const fe4_t zero = {{ _mm256_setzero_si256() }};
+			fe4_t n;
+			__fe4_sub(&n, &zero, &tbl[2*i+1], 0);
+			__fe4_carry(&n);
+			FE4_BLEND(&tbl[2*i+1], &tbl[2*i+1], &n, L3);
+		}
+	}
+	return tbl;
+}
+
+void __ifma_tblfree(void *tbl){
+	free(tbl);
+}
+
+static IFMA_TARGET inline void __ifma_addnaf(fe4_t *acc, const fe4_t *tbl, int8_t d){
+	if( d > 0 ){
+		__ge4_add(acc, acc, &tbl[2*(d/2)]);
+	}else{
+		__ge4_add(acc, acc, &tbl[2*((-d)/2)+1]);
+	}
+}
+
+IFMA_TARGET int __ifma_straus(ge_p3_t *out, int i,
+		const int8_t *naf, const ge_p3_t *pt, size_t n,
+		const int8_t *fnaf, const ge_fbase_t *const *fb, size_t nf){
+	const size_t tn = 1 << (MSM_PWIDTH-2);
+	fe4_t stbl[2*MSM_STACK_TERMS << (MSM_PWIDTH-2)], *tbl = stbl;
+	fe4_t acc, c2[2];
+
+	if( !__ifma_ok() ) return -1;
+	if( n > MSM_STACK_TERMS && posix_memalign((void **)&tbl, 32, 2*n*tn*sizeof(fe4_t)) != 0 ) return -1;
+	for(size_t j=0;j<n;j++){
+		fe4_t *t = tbl + 2*tn*j;
+		__ge4_pack(&acc, &pt[j]);
+		__ge4_cached(t, &acc);
+		__ge4_dbl(c2, &acc);
+		__ge4_cached(c2, c2);
+		for(size_t k=1;k<tn;k++){
+			__ge4_add(&acc, &acc, c2);
+			__ge4_cached(t + 2*k, &acc);
+		}
+	}
+
+	// identity (0, 1, 1, 0)
+	acc.l[0] = _mm256_set_epi64x(0, 1, 1, 0);
+	for(int k=1;k<5;k++) acc.l[k] = _mm256_setzero_si256();
+	for(;i>=0;i--){
+		__ge4_dbl(&acc, &acc);
+		for(size_t j=0;j<nf;j++){
+			if( fnaf[256*j + i] ) __ifma_addnaf(&acc, (const fe4_t *)fb[j]->odd4, fnaf[256*j + i]);
+		}
+		for(size_t j=0;j<n;j++){
+			if( naf[256*j + i] ) __ifma_addnaf(&acc, tbl + 2*tn*j, naf[256*j + i]);
+		}
+	}
+	__ge4_unpack(out, &acc);
+	if( tbl != stbl ) free(tbl);
+	return 0;
+}
+
+#else
+
+int __ifma_ok(void){
+	return 0;
+}
+
+void *__ifma_tbl(const ge_cached_t *c, size_t cnt){
+	(void)c; (void)cnt;
+	return NULL;
+}
+
+void __ifma_tblfree(void *tbl){
+	(void)tbl;
+}
+
+int __ifma_straus(ge_p3_t *out, int i,
+		const int8_t *naf, const ge_p3_t *pt, size_t n,
+		const int8_t *fnaf, const ge_fbase_t *const *fb, size_t nf){
+	(void)out; (void)i; (void)naf; (void)pt; (void)n; (void)fnaf; (void)fb; (void)nf;
+	return -1;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sodium.h>
+#include "__crypto.h"
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__msm.h"
+#include "__kcache.h"
+
+#define KCACHE_BUCKETS (2*KCACHE_SLOTS)
+
+struct __kcache_ent {
+	uint8_t id[KCACHE_IDLEN];
+	ge_p3_t K;
+	struct __kcache_ent *hnext; //bucket chain
+	struct __kcache_ent *prev, *next; //lru list, head is the most recent
+};
+
+struct __kcache {
+	struct __kcache_ent *pool; //allocated on first put
+	struct __kcache_ent *bkt[KCACHE_BUCKETS];
+	struct __kcache_ent *head, *tail;
+	size_t used;
+	unsigned long hits, misses;
+	pthread_mutex_t lock;
+};
+
+// the process cache, used for a NULL kcache_t
+static kcache_t __kc_proc = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static kcache_t *__kcache_sel(kcache_t *kc){
+	return (kc != NULL) ? kc : &__kc_proc;
+}
+
+kcache_t *__kcache_new(void){
+	kcache_t *kc = (kcache_t *)calloc(1, sizeof(kcache_t));
+	if( kc != NULL && pthread_mutex_init(&kc->lock, NULL) != 0 ){
+		free(kc);
+		kc = NULL;
+	}
+	return kc;
+}
+
+void __kcache_free(kcache_t *kc){
+	if( kc == NULL ) return;
+	free(kc->pool);
+	pthread_mutex_destroy(&kc->lock);
+	free(kc);
+}
+
+void __kcache_id(uint8_t *out, uint8_t an,
+		const uint8_t *mpk, size_t mpklen,
+		const uint8_t *mbuf, size_t mlen,
+		const uint8_t *U){
+	crypto_generichash_blake2b_state st;
+	uint8_t hdr[9];
+	hdr[0] = an;
+	for(int i=0;i<8;i++) hdr[i+1] = (uint8_t)((uint64_t)mlen >> (8*i));
+	crypto_generichash_blake2b_init(&st, NULL, 0, KCACHE_IDLEN);
+	crypto_generichash_blake2b_update(&st, hdr, sizeof(hdr));
+	crypto_generichash_blake2b_update(&st, mpk, mpklen);
+	crypto_generichash_blake2b_update(&st, mbuf, mlen);
+	crypto_generichash_blake2b_update(&st, U, 32);
+	crypto_generichash_blake2b_final(&st, out, KCACHE_IDLEN);
+}
+
+int __kcache_kgen(ge_p3_t *K, const uint8_t *A, const ge_fbase_t *At,
+		const uint8_t *U, const uint8_t *mbuf, size_t mlen, uint8_t hid){
+	uint8_t x[RRS];
+	const size_t nf = (At != NULL) ? 1 : 0; //A is a fixed base once prepared
+	ge_p3_t pA, pU, xA;
+	int rc;
+
+	__h2s(hid, mbuf, mlen, U, A, x);
+	rc = (nf == 0) ? __ge_frombytes(&pA, A) : 0;
+	rc += __ge_frombytes(&pU, U);
+	if( rc != 0 ) return -1;
+	rc = (nf == 0) ? __ge_scalarmult_vartime(&xA, x, &pA) :
+		__msm_vartime_fb(&xA, x, &At, 1, NULL, NULL, 0);
+	__ge_p3_sub(K, &pU, &xA);
+	return rc;
+}
+
+static size_t __kcache_bucket(const uint8_t *id){
+	uint32_t h = (uint32_t)id[0] | ((uint32_t)id[1] << 8) | ((uint32_t)id[2] << 16) | ((uint32_t)id[3] << 24);
+	return h % KCACHE_BUCKETS;
+}
+
+static void __kcache_unlink(kcache_t *kc, struct __kcache_ent *e){
+	if( e->prev ) e->prev->next = e->next; else kc->head = e->next;
+	if( e->next ) e->next->prev = e->prev; else kc->tail = e->prev;
+}
+
+static void __kcache_pushfront(kcache_t *kc, struct __kcache_ent *e){
+	e->prev = NULL;
+	e->next = kc->head;
+	if( kc->head ) kc->head->prev = e; else kc->tail = e;
+	kc->head = e;
+}
+
+static struct __kcache_ent *__kcache_find(kcache_t *kc, const uint8_t *id){
+	struct __kcache_ent *e;
+	for(e=kc->bkt[__kcache_bucket(id)];e!=NULL;e=e->hnext){
+		if( memcmp(e->id, id, KCACHE_IDLEN) == 0 ) break;
+	}
+	return e;
+}
+
+int __kcache_get(kcache_t *kc, const uint8_t *id, ge_p3_t *K){
+	struct __kcache_ent *e;
+	int rc = -1;
+	kc = __kcache_sel(kc);
+	pthread_mutex_lock(&kc->lock);
+	if( kc->pool != NULL && (e = __kcache_find(kc, id)) != NULL ){
+		__kcache_unlink(kc, e);
+		__kcache_pushfront(kc, e);
+		*K = e->K;
+		rc = 0;
+	}
+	if( rc == 0 ) kc->hits++;
+	else kc->misses++;
+	pthread_mutex_unlock(&kc->lock);
+	return rc;
+}
+
+void __kcache_put(kcache_t *kc, const uint8_t *id, const ge_p3_t *K){
+	struct __kcache_ent *e, **pp;
+	kc = __kcache_sel(kc);
+	pthread_mutex_lock(&kc->lock);
+	if( kc->pool == NULL ){
+		kc->pool = (struct __kcache_ent *)calloc( KCACHE_SLOTS, sizeof(struct __kcache_ent) );
+		if( kc->pool == NULL ) goto done; //no cache, not an error
+	}
+	if( (e = __kcache_find(kc, id)) != NULL ){
+		__kcache_unlink(kc, e);
+	}else if( kc->used < KCACHE_SLOTS ){
+		e = &kc->pool[kc->used++];
+		memcpy(e->id, id, KCACHE_IDLEN);
+		pp = &kc->bkt[__kcache_bucket(id)];
+		e->hnext = *pp;
+		*pp = e;
+	}else{
+		// evict the least recently used entry and reuse it
+		e = kc->tail;
+		__kcache_unlink(kc, e);
+		for(pp=&kc->bkt[__kcache_bucket(e->id)];*pp!=e;pp=&(*pp)->hnext);
+		*pp = e->hnext;
+		memcpy(e->id, id, KCACHE_IDLEN);
+		pp = &kc->bkt[__kcache_bucket(id)];
+		e->hnext = *pp;
+		*pp = e;
+	}
+	e->K = *K;
+	__kcache_pushfront(kc, e);
+done:
+	pthread_mutex_unlock(&kc->lock);
+}
+
+void __kcache_clear(kcache_t *kc){
+	kc = __kcache_sel(kc);
+	pthread_mutex_lock(&kc->lock);
+	free(kc->pool);
+	kc->pool = NULL;
+	memset(kc->bkt, 0, sizeof(kc->bkt));
+	kc->head = kc->tail = NULL;
+	kc->used = 0;
+	pthread_mutex_unlock(&kc->lock);
+}
+
+void __kcache_stats(kcache_t *kc, unsigned long *hits, unsigned long *misses, size_t *used){
+	kc = __kcache_sel(kc);
+	pthread_mutex_lock(&kc->lock);
+	*hits = kc->hits;
+	*misses = kc->misses;
+	*used = kc->used;
+	pthread_mutex_unlock(&kc->lock);
+}
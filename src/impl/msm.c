@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__msm.h"
+#include "__ifma.h"
+#include "__par.h"
+
+// builds the odd multiples P, 3P, ... of p into tbl (cnt entries)
+void __msm_oddtbl(ge_cached_t *tbl, const ge_p3_t *p, size_t cnt){
+	ge_p1p1_t t; ge_p3_t p2, u;
+	ge_cached_t c2;
+	__ge_p3_to_cached(&tbl[0], p);
+	__ge_p3_dbl(&t, p);
+	__ge_p1p1_to_p3(&p2, &t);
+	__ge_p3_to_cached(&c2, &p2);
+	u = *p;
+	for(size_t i=1;i<cnt;i++){
+		__ge_add(&t, &u, &c2);
+		__ge_p1p1_to_p3(&u, &t);
+		__ge_p3_to_cached(&tbl[i], &u);
+	}
+}
+
+// width-w non adjacent form, odd digits in (-2^(w-1), 2^(w-1))
+static void __msm_wnaf(int8_t *naf, const uint8_t *a, int w){
+	uint64_t x[5] = {0};
+	const uint64_t width = (uint64_t)1 << w, mask = width - 1;
+	uint64_t carry = 0, buf, win;
+	size_t pos = 0;
+
+	for(int i=0;i<32;i++) x[i/8] |= (uint64_t)a[i] << (8*(i%8));
+	memset(naf, 0, 256);
+	while( pos < 256 ){
+		size_t li = pos / 64, bi = pos % 64;
+		if( bi < 64 - (size_t)w ){
+			buf = x[li] >> bi;
+		}else{
+			buf = (x[li] >> bi) | (x[li+1] << (64 - bi));
+		}
+		win = carry + (buf & mask);
+		if( (win & 1) == 0 ){
+			pos++;
+			continue;
+		}
+		if( win < width/2 ){
+			carry = 0;
+			naf[pos] = (int8_t)win;
+		}else{
+			carry = 1;
+			naf[pos] = (int8_t)((int64_t)win - (int64_t)width);
+		}
+		pos += w;
+	}
+}
+
+static inline void __msm_addnaf(ge_p1p1_t *t, const ge_cached_t *tbl, int8_t d){
+	ge_p3_t u;
+	__ge_p1p1_to_p3(&u, t);
+	if( d > 0 ){
+		__ge_add(t, &u, &tbl[d/2]);
+	}else{
+		__ge_sub(t, &u, &tbl[(-d)/2]);
+	}
+}
+
+// interleaved wnaf, one doubling chain shared by every term
+static int __msm_straus(ge_p3_t *out,
+		const uint8_t *fsc, const ge_fbase_t *const *fb, size_t nf,
+		const uint8_t *sc, const ge_p3_t *pt, size_t n){
+	const size_t tn = 1 << (MSM_PWIDTH-2);
+	int8_t snaf[MSM_STACK_TERMS*256 + 1], *naf = snaf, *fnaf;
+	ge_cached_t stbl[MSM_STACK_TERMS << (MSM_PWIDTH-2)], *tbl = stbl;
+	const int heap = (n + nf > MSM_STACK_TERMS); //single/double mults stay off the heap
+	int ifma = __ifma_ok();
+	ge_p1p1_t t; ge_p2_t r;
+	int i;
+
+	if( heap ){
+		naf = (int8_t *)malloc( (n+nf)*256 + 1 );
+		if( naf == NULL ) return -1;
+	}
+	fnaf = naf + n*256;
+	for(size_t j=0;j<n;j++){
+		__msm_wnaf(naf + 256*j, sc + 32*j, MSM_PWIDTH);
+	}
+	for(size_t j=0;j<nf;j++){
+		__msm_wnaf(fnaf + 256*j, fsc + 32*j, FBASE_ODDW);
+		if( fb[j]->odd4 == NULL ) ifma = 0;
+	}
+
+	// skip the leading zero digits
+	for(i=255;i>=0;i--){
+		int nz = 0;
+		for(size_t j=0;j<n+nf && !nz;j++) nz = naf[256*j + i];
+		if( nz ) break;
+	}
+
+	if( ifma && __ifma_straus(out, i, naf, pt, n, fnaf, fb, nf) == 0 ){
+		if( heap ) free(naf);
+		return 0;
+	}
+
+	if( heap && n > 0 ){
+		tbl = (ge_cached_t *)malloc( n*tn*sizeof(ge_cached_t) );
+		if( tbl == NULL ){
+			free(naf);
+			return -1;
+		}
+	}
+	for(size_t j=0;j<n;j++){
+		__msm_oddtbl(tbl + tn*j, &pt[j], tn);
+	}
+
+	__ge_p3_0(out);
+	if( i >= 0 ){
+		__ge_p3_to_p2(&r, out);
+		for(;i>=0;i--){
+			__ge_p2_dbl(&t, &r);
+			for(size_t j=0;j<nf;j++){
+				if( fnaf[256*j + i] ) __msm_addnaf(&t, fb[j]->odd, fnaf[256*j + i]);
+			}
+			for(size_t j=0;j<n;j++){
+				if( naf[256*j + i] ) __msm_addnaf(&t, tbl + tn*j, naf[256*j + i]);
+			}
+			if( i > 0 ) __ge_p1p1_to_p2(&r, &t);
+		}
+		__ge_p1p1_to_p3(out, &t);
+	}
+	if( heap ){
+		free(naf);
+		if( n > 0 ) free(tbl);
+	}
+	return 0;
+}
+
+// signed radix 2^c digits in [-2^(c-1), 2^(c-1)), scalars < 2^253
+static void __msm_radix(int16_t *dig, const uint8_t *a, int c, int nd){
+	uint64_t x[5] = {0};
+	const uint64_t mask = ((uint64_t)1 << c) - 1;
+	int64_t carry = 0, d;
+
+	for(int i=0;i<32;i++) x[i/8] |= (uint64_t)a[i] << (8*(i%8));
+	for(int w=0;w<nd;w++){
+		size_t pos = (size_t)w*c, li = pos / 64, bi = pos % 64;
+		uint64_t buf = x[li] >> bi;
+		if( bi + c > 64 && li < 4 ) buf |= x[li+1] << (64 - bi);
+		d = (int64_t)(buf & mask) + carry;
+		carry = (d + ((int64_t)1 << (c-1))) >> c;
+		dig[w] = (int16_t)(d - (carry << c));
+	}
+}
+
+// bucket method for large batches
+static int __msm_pippenger(ge_p3_t *out, const uint8_t *sc, const ge_p3_t *pt, size_t n){
+	const int c = (n < 500) ? 6 : (n < 800) ? 7 : 8;
+	const int nd = (256 + c - 1) / c;
+	const size_t nb = (size_t)1 << (c-1);
+	int16_t *dig = (int16_t *)malloc( n*nd*sizeof(int16_t) );
+	ge_cached_t *cpt = (ge_cached_t *)malloc( n*sizeof(ge_cached_t) );
+	ge_p3_t *bkt = (ge_p3_t *)malloc( nb*sizeof(ge_p3_t) );
+	uint8_t *used = (uint8_t *)malloc( nb );
+	ge_p1p1_t t; ge_p2_t r2; ge_p3_t r, sum, acc;
+	ge_cached_t cc;
+
+	if( dig == NULL || cpt == NULL || bkt == NULL || used == NULL ){
+		free(dig); free(cpt); free(bkt); free(used);
+		return -1;
+	}
+	for(size_t j=0;j<n;j++){
+		__msm_radix(dig + j*nd, sc + 32*j, c, nd);
+		__ge_p3_to_cached(&cpt[j], &pt[j]);
+	}
+
+	__ge_p3_0(&r);
+	for(int w=nd-1;w>=0;w--){
+		// r = 2^c r
+		if( w != nd-1 ){
+			__ge_p3_to_p2(&r2, &r);
+			for(int k=0;k<c;k++){
+				__ge_p2_dbl(&t, &r2);
+				if( k < c-1 ) __ge_p1p1_to_p2(&r2, &t);
+			}
+			__ge_p1p1_to_p3(&r, &t);
+		}
+
+		memset(used, 0, nb);
+		for(size_t j=0;j<n;j++){
+			int16_t d = dig[j*nd + w];
+			size_t b;
+			if( d == 0 ) continue;
+			b = (d > 0) ? (size_t)(d-1) : (size_t)(-d-1);
+			if( !used[b] ){
+				__ge_p3_0(&bkt[b]);
+				used[b] = 1;
+			}
+			if( d > 0 ){
+				__ge_add(&t, &bkt[b], &cpt[j]);
+			}else{
+				__ge_sub(&t, &bkt[b], &cpt[j]);
+			}
+			__ge_p1p1_to_p3(&bkt[b], &t);
+		}
+
+		// sum_k (k+1) bkt[k] by running sums
+		__ge_p3_0(&sum);
+		__ge_p3_0(&acc);
+		for(size_t k=nb;k-->0;){
+			if( used[k] ){
+				__ge_p3_to_cached(&cc, &bkt[k]);
+				__ge_add(&t, &sum, &cc);
+				__ge_p1p1_to_p3(&sum, &t);
+			}
+			__ge_p3_to_cached(&cc, &sum);
+			__ge_add(&t, &acc, &cc);
+			__ge_p1p1_to_p3(&acc, &t);
+		}
+		__ge_p3_to_cached(&cc, &acc);
+		__ge_add(&t, &r, &cc);
+		__ge_p1p1_to_p3(&r, &t);
+	}
+
+	*out = r;
+	free(dig); free(cpt); free(bkt); free(used);
+	return 0;
+}
+
+struct __msm_fbjob {
+	ge_p3_t r;
+	const uint8_t *fsc;
+	const ge_fbase_t *const *fb;
+	size_t nf;
+	int rc;
+};
+
+static void __msm_fbrun(void *arg){
+	struct __msm_fbjob *j = (struct __msm_fbjob *)arg;
+	j->rc = __msm_straus(&j->r, j->fsc, j->fb, j->nf, NULL, NULL, 0);
+}
+
+// a single equation split over two doubling chains: the fixed bases go to a
+// helper (half of them if there are no variable points) and the caller
+// takes the rest, for latency at about the same total cost
+static int __msm_par(ge_p3_t *out,
+		const uint8_t *fsc, const ge_fbase_t *const *fb, size_t nf,
+		const uint8_t *sc, const ge_p3_t *pt, size_t n){
+	struct __msm_fbjob fj;
+	par_job_t job;
+	ge_cached_t cc; ge_p1p1_t t;
+	int rc;
+
+	fj.fsc = fsc;
+	fj.fb = fb;
+	fj.nf = (n > 0) ? nf : nf/2;
+	if( fj.nf == 0 || __par_submit(&job, __msm_fbrun, &fj) != 0 ){
+		return __msm_straus(out, fsc, fb, nf, sc, pt, n);
+	}
+	rc = __msm_straus(out, fsc + 32*fj.nf, fb + fj.nf, nf - fj.nf, sc, pt, n);
+	__par_wait(&job);
+	if( rc == 0 && fj.rc == 0 ){
+		__ge_p3_to_cached(&cc, &fj.r);
+		__ge_add(&t, out, &cc);
+		__ge_p1p1_to_p3(out, &t);
+	}
+	return (rc != 0) ? rc : fj.rc;
+}
+
+int __msm_vartime_fb(ge_p3_t *out,
+		const uint8_t *fsc, const ge_fbase_t *const *fb, size_t nf,
+		const uint8_t *sc, const ge_p3_t *pt, size_t n){
+	ge_p3_t fp; ge_cached_t cc; ge_p1p1_t t;
+	int rc;
+	if( nf > 0 && __fbase_init() != 0 ) return -1; //fb may point at the generator
+	if( n + nf > 1 && n + nf <= MSM_PAR_MAX && __par_n() > 0 ){
+		return __msm_par(out, fsc, fb, nf, sc, pt, n);
+	}
+	if( n < MSM_PIPPENGER_MIN ){
+		return __msm_straus(out, fsc, fb, nf, sc, pt, n);
+	}
+	rc = __msm_pippenger(out, sc, pt, n);
+	if( rc == 0 && nf > 0 ){
+		rc = __msm_straus(&fp, fsc, fb, nf, NULL, NULL, 0);
+		__ge_p3_to_cached(&cc, &fp);
+		__ge_add(&t, out, &cc);
+		__ge_p1p1_to_p3(out, &t);
+	}
+	return rc;
+}
+
+int __msm_vartime(ge_p3_t *out, const uint8_t *bsc, const uint8_t *sc, const ge_p3_t *pt, size_t n){
+	const ge_fbase_t *fb = &__fbase_B;
+	return __msm_vartime_fb(out, bsc, &fb, (bsc != NULL), sc, pt, n);
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE //cpu affinity
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include "__par.h"
+
+#define PAR_MAXN 64
+#define PAR_SPIN 20000 //polls before an idle helper or a waiter backs off
+
+// job states, done is set once the job ran
+#define PAR_QUEUED  0
+#define PAR_RUNNING 1
+#define PAR_DONE    2
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cv;
+	par_job_t *head, *tail;
+	size_t n; //running helpers
+	size_t queued; //polled by idle helpers without the lock
+	int stop;
+	pthread_t th[PAR_MAXN];
+} __par = { .lock = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER };
+static pthread_once_t __par_once = PTHREAD_ONCE_INIT;
+
+static inline void __par_pause(void){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+// the helpers do not survive fork, the child runs without a pool
+static void __par_child(void){
+	pthread_mutex_init(&__par.lock, NULL);
+	pthread_cond_init(&__par.cv, NULL);
+	__par.head = __par.tail = NULL;
+	__par.n = 0;
+	__par.queued = 0;
+	__par.stop = 0;
+}
+
+static void __par_initonce(void){
+	pthread_atfork(NULL, NULL, __par_child);
+}
+
+// first queued job, called with the lock held
+static par_job_t *__par_pop(void){
+	par_job_t *j = __par.head;
+	if( j == NULL ) return NULL;
+	__par.head = j->next;
+	if( __par.head == NULL ) __par.tail = NULL;
+	__atomic_store_n(&__par.queued, __par.queued - 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&j->done, PAR_RUNNING, __ATOMIC_RELAXED);
+	return j;
+}
+
+static void *__par_main(void *arg){
+	par_job_t *j;
+	(void)arg;
+	for(;;){
+		//stay awake for a while after a job, logins come in bursts
+		for(int k=0;k<PAR_SPIN && __atomic_load_n(&__par.queued, __ATOMIC_RELAXED) == 0;k++)
+			__par_pause();
+		pthread_mutex_lock(&__par.lock);
+		while( __par.head == NULL && !__par.stop ) pthread_cond_wait(&__par.cv, &__par.lock);
+		j = __par_pop();
+		pthread_mutex_unlock(&__par.lock);
+		if( j == NULL ) break; //stopped
+		j->fn(j->arg);
+		__atomic_store_n(&j->done, PAR_DONE, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+static void __par_stopall(void){
+	size_t n;
+	pthread_mutex_lock(&__par.lock);
+	__par.stop = 1;
+	n = __par.n;
+	__atomic_store_n(&__par.n, 0, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&__par.cv);
+	pthread_mutex_unlock(&__par.lock);
+	for(size_t k=0;k<n;k++) pthread_join(__par.th[k], NULL);
+	__par.stop = 0;
+}
+
+int __par_start(size_t n){
+	int cpu[CPU_SETSIZE];
+	cpu_set_t all, one;
+	int ncpu = 0;
+	size_t k;
+
+	pthread_once(&__par_once, __par_initonce);
+	__par_stopall();
+	if( sched_getaffinity(0, sizeof(all), &all) != 0 ) CPU_ZERO(&all);
+	for(int c=0;c<CPU_SETSIZE;c++) if( CPU_ISSET(c, &all) ) cpu[ncpu++] = c;
+	//a helper without a core of its own only slows the caller down
+	if( ncpu <= 1 ) n = 0; //also when the affinity mask is unknown
+	else if( n > (size_t)ncpu - 1 ) n = ncpu - 1;
+	if( n > PAR_MAXN ) n = PAR_MAXN;
+
+	for(k=0;k<n;k++){
+		if( pthread_create(&__par.th[k], NULL, __par_main, NULL) != 0 ) break;
+		//one allowed cpu each, the first one is left to the caller
+		CPU_ZERO(&one);
+		CPU_SET(cpu[1 + k], &one);
+		pthread_setaffinity_np(__par.th[k], sizeof(one), &one);
+	}
+	pthread_mutex_lock(&__par.lock);
+	__atomic_store_n(&__par.n, k, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&__par.lock);
+	if( k < n ){
+		__par_stopall();
+		return -1;
+	}
+	return 0;
+}
+
+size_t __par_n(void){
+	return __atomic_load_n(&__par.n, __ATOMIC_ACQUIRE);
+}
+
+int __par_submit(par_job_t *j, void (*fn)(void *), void *arg){
+	if( __par_n() == 0 ) return -1;
+	j->fn = fn;
+	j->arg = arg;
+	j->done = PAR_QUEUED;
+	j->next = NULL;
+	pthread_mutex_lock(&__par.lock);
+	if( __par.n == 0 ){
+		pthread_mutex_unlock(&__par.lock);
+		return -1;
+	}
+	if( __par.tail != NULL ) __par.tail->next = j;
+	else __par.head = j;
+	__par.tail = j;
+	__atomic_store_n(&__par.queued, __par.queued + 1, __ATOMIC_RELAXED);
+	pthread_cond_signal(&__par.cv);
+	pthread_mutex_unlock(&__par.lock);
+	return 0;
+}
+
+// a job no helper has taken yet is taken back and run by the waiter, so a
+// busy pool never makes the caller slower than running everything itself
+void __par_wait(par_job_t *j){
+	par_job_t **p, *prev = NULL;
+	int k;
+
+	if( __atomic_load_n(&j->done, __ATOMIC_ACQUIRE) == PAR_QUEUED ){
+		pthread_mutex_lock(&__par.lock);
+		if( j->done == PAR_QUEUED ){
+			for(p=&__par.head;*p!=j;p=&(*p)->next) prev = *p;
+			*p = j->next;
+			if( __par.tail == j ) __par.tail = prev;
+			__atomic_store_n(&__par.queued, __par.queued - 1, __ATOMIC_RELAXED);
+			j->done = PAR_RUNNING;
+			pthread_mutex_unlock(&__par.lock);
+			j->fn(j->arg);
+			j->done = PAR_DONE;
+			return;
+		}
+		pthread_mutex_unlock(&__par.lock);
+	}
+	for(k=0;__atomic_load_n(&j->done, __ATOMIC_ACQUIRE) != PAR_DONE;k++){
+		if( k < PAR_SPIN ) __par_pause();
+		else sched_yield();
+	}
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE //MADV_DONTDUMP
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sodium.h>
+#include "__sarena.h"
+
+#define SARENA_CLASSES 4 //32, 64, 128 and 256 byte slots
+
+struct __sarena_chunk {
+	uint8_t *base; //SARENA_CHUNK bytes between two guard pages
+	size_t cls;
+	size_t nfree;
+	uint16_t *fl; //free slot indices
+	struct __sarena_chunk *next;
+};
+
+static struct __sarena_chunk *__sarena_head = NULL;
+static pthread_mutex_t __sarena_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t __sarena_once = PTHREAD_ONCE_INIT;
+
+static inline size_t __sarena_slot(size_t cls){
+	return (size_t)32 << cls;
+}
+
+// a fork must not find the lock taken by a thread the child does not have
+static void __sarena_prepare(void){ pthread_mutex_lock(&__sarena_lock); }
+static void __sarena_release(void){ pthread_mutex_unlock(&__sarena_lock); }
+
+static void __sarena_initonce(void){
+	pthread_atfork(__sarena_prepare, __sarena_release, __sarena_release);
+}
+
+// a new region for class cls, called with the lock held
+static struct __sarena_chunk *__sarena_grow(size_t cls){
+	const size_t pg = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t n = SARENA_CHUNK / __sarena_slot(cls);
+	struct __sarena_chunk *c = (struct __sarena_chunk *)malloc( sizeof(struct __sarena_chunk) );
+	uint8_t *m;
+
+	if( c == NULL ) return NULL;
+	c->fl = (uint16_t *)malloc( n*sizeof(uint16_t) );
+	m = (uint8_t *)mmap(NULL, SARENA_CHUNK + 2*pg, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if( c->fl == NULL || m == MAP_FAILED ){
+		if( m != MAP_FAILED ) munmap(m, SARENA_CHUNK + 2*pg);
+		free(c->fl);
+		free(c);
+		return NULL;
+	}
+	c->base = m + pg;
+	if( mprotect(c->base, SARENA_CHUNK, PROT_READ | PROT_WRITE) != 0 ){
+		munmap(m, SARENA_CHUNK + 2*pg);
+		free(c->fl);
+		free(c);
+		return NULL;
+	}
+	mlock(c->base, SARENA_CHUNK); //best effort, as sodium_malloc
+#ifdef MADV_DONTDUMP
+	madvise(c->base, SARENA_CHUNK, MADV_DONTDUMP);
+#endif
+	for(size_t i=0;i<n;i++) c->fl[i] = (uint16_t)(n-1-i); //low slots first
+	c->cls = cls;
+	c->nfree = n;
+	c->next = __sarena_head;
+	__sarena_head = c;
+	return c;
+}
+
+void *__sarena_alloc(size_t len){
+	struct __sarena_chunk *c;
+	size_t cls;
+	void *p = NULL;
+
+	if( len > __sarena_slot(SARENA_CLASSES-1) ) return sodium_malloc(len);
+	for(cls=0;len > __sarena_slot(cls);cls++);
+	pthread_once(&__sarena_once, __sarena_initonce);
+	pthread_mutex_lock(&__sarena_lock);
+	for(c=__sarena_head;c!=NULL && (c->cls != cls || c->nfree == 0);c=c->next);
+	if( c == NULL ) c = __sarena_grow(cls);
+	if( c != NULL ) p = c->base + (size_t)c->fl[--c->nfree] * __sarena_slot(cls);
+	pthread_mutex_unlock(&__sarena_lock);
+	return p;
+}
+
+void __sarena_free(void *vp){
+	uint8_t *p = (uint8_t *)vp;
+	struct __sarena_chunk *c;
+	size_t sz;
+
+	if( p == NULL ) return;
+	pthread_mutex_lock(&__sarena_lock);
+	for(c=__sarena_head;c!=NULL && (p < c->base || p >= c->base + SARENA_CHUNK);c=c->next);
+	if( c != NULL ){
+		sz = __sarena_slot(c->cls);
+		sodium_memzero(p, sz);
+		c->fl[c->nfree++] = (uint16_t)((size_t)(p - c->base) / sz);
+	}
+	pthread_mutex_unlock(&__sarena_lock);
+	if( c == NULL ) sodium_free(p); //larger than a slot
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "__sc25519.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SC_TARGET __attribute__((target("bmi2"))) //mulx, checked by the backend
+#else
+#define SC_TARGET
+#endif
+
+typedef unsigned __int128 u128;
+
+static const uint64_t SC_L[4] = {
+	0x5812631a5cf5d3edULL, 0x14def9dea2f79cd6ULL, 0x0000000000000000ULL, 0x1000000000000000ULL
+};
+static const uint64_t SC_16L[5] = { //16l = 2^256 + ...
+	0x812631a5cf5d3ed0ULL, 0x4def9dea2f79cd65ULL, 0x0000000000000001ULL, 0x0000000000000000ULL, 1
+};
+static const uint64_t SC_R2[4] = { //2^512 mod l
+	0xa40611e3449c0f01ULL, 0xd00e1ba768859347ULL, 0xceec73d217f5be65ULL, 0x0399411b7c309a3dULL
+};
+#define SC_MP 0xd2b51da312547e1bULL //-1/l mod 2^64
+
+static inline void __sc_load(uint64_t *x, const uint8_t *s){
+	for(int i=0;i<4;i++, s+=8){ //little endian, compiles to plain loads
+		x[i] = (uint64_t)s[0] | ((uint64_t)s[1] << 8) | ((uint64_t)s[2] << 16) | ((uint64_t)s[3] << 24) |
+			((uint64_t)s[4] << 32) | ((uint64_t)s[5] << 40) | ((uint64_t)s[6] << 48) | ((uint64_t)s[7] << 56);
+	}
+}
+
+static inline void __sc_store(uint8_t *s, const uint64_t *x){
+	for(int i=0;i<4;i++, s+=8){
+		s[0] = (uint8_t)x[i]; s[1] = (uint8_t)(x[i] >> 8); s[2] = (uint8_t)(x[i] >> 16); s[3] = (uint8_t)(x[i] >> 24);
+		s[4] = (uint8_t)(x[i] >> 32); s[5] = (uint8_t)(x[i] >> 40); s[6] = (uint8_t)(x[i] >> 48); s[7] = (uint8_t)(x[i] >> 56);
+	}
+}
+
+// x < 2^260 (5 limbs) mod l, using 2^252 = -(l - 2^252) mod l
+static inline void __sc_fold(uint64_t *r, const uint64_t *x){
+	const uint64_t hi = (x[3] >> 60) | (x[4] << 4);
+	uint64_t p[2], lo3 = x[3] & 0x0fffffffffffffffULL, b = 0, m;
+	u128 t;
+	t = (u128)hi * SC_L[0];
+	p[0] = (uint64_t)t;
+	t = (u128)hi * SC_L[1] + (uint64_t)(t >> 64);
+	p[1] = (uint64_t)t;
+	const uint64_t p2 = (uint64_t)(t >> 64);
+	t = (u128)x[0] - p[0];            r[0] = (uint64_t)t; b = (uint64_t)(t >> 64) & 1;
+	t = (u128)x[1] - p[1] - b;        r[1] = (uint64_t)t; b = (uint64_t)(t >> 64) & 1;
+	t = (u128)x[2] - p2 - b;          r[2] = (uint64_t)t; b = (uint64_t)(t >> 64) & 1;
+	t = (u128)lo3 - b;                r[3] = (uint64_t)t; b = (uint64_t)(t >> 64) & 1;
+	m = -b; //went negative, add l back
+	t = (u128)r[0] + (SC_L[0] & m);                      r[0] = (uint64_t)t;
+	t = (u128)r[1] + (SC_L[1] & m) + (uint64_t)(t >> 64); r[1] = (uint64_t)t;
+	t = (u128)r[2] + (uint64_t)(t >> 64);                r[2] = (uint64_t)t;
+	r[3] = r[3] + (SC_L[3] & m) + (uint64_t)(t >> 64);
+}
+
+// one CIOS round: t = (t + a bi + m l) / 2^64, m = -(t + a bi) / l mod 2^64
+#define SC_ROUND(bi) do { \
+	u = (u128)a[0] * (bi) + t0;             t0 = (uint64_t)u; c = (uint64_t)(u >> 64); \
+	u = (u128)a[1] * (bi) + t1 + c;         t1 = (uint64_t)u; c = (uint64_t)(u >> 64); \
+	u = (u128)a[2] * (bi) + t2 + c;         t2 = (uint64_t)u; c = (uint64_t)(u >> 64); \
+	u = (u128)a[3] * (bi) + t3 + c;         t3 = (uint64_t)u; c = (uint64_t)(u >> 64); \
+	u = (u128)t4 + c;                       t4 = (uint64_t)u; t5 = (uint64_t)(u >> 64); \
+	m = t0 * SC_MP; \
+	u = (u128)m * SC_L[0] + t0;             c = (uint64_t)(u >> 64); \
+	u = (u128)m * SC_L[1] + t1 + c;         t0 = (uint64_t)u; c = (uint64_t)(u >> 64); \
+	u = (u128)t2 + c;                       t1 = (uint64_t)u; c = (uint64_t)(u >> 64); \
+	u = (u128)m * SC_L[3] + t3 + c;         t2 = (uint64_t)u; c = (uint64_t)(u >> 64); \
+	u = (u128)t4 + c;                       t3 = (uint64_t)u; t4 = t5 + (uint64_t)(u >> 64); \
+} while(0)
+
+// r = a b / 2^256 mod l, needs a b < l 2^256
+SC_TARGET static inline void __sc_montmul(uint64_t *r, const uint64_t *a, const uint64_t *b){
+	uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0, t5, s[4], m, c, bw;
+	const uint64_t b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3];
+	u128 u;
+	SC_ROUND(b0);
+	SC_ROUND(b1);
+	SC_ROUND(b2);
+	SC_ROUND(b3);
+	// t < 2l, subtract l unless that borrows
+	u = (u128)t0 - SC_L[0];          s[0] = (uint64_t)u; bw = (uint64_t)(u >> 64) & 1;
+	u = (u128)t1 - SC_L[1] - bw;     s[1] = (uint64_t)u; bw = (uint64_t)(u >> 64) & 1;
+	u = (u128)t2 - bw;               s[2] = (uint64_t)u; bw = (uint64_t)(u >> 64) & 1;
+	u = (u128)t3 - SC_L[3] - bw;     s[3] = (uint64_t)u; bw = (uint64_t)(u >> 64) & 1;
+	bw = (uint64_t)(((u128)t4 - bw) >> 64) & 1;
+	m = -bw;
+	r[0] = (t0 & m) | (s[0] & ~m);
+	r[1] = (t1 & m) | (s[1] & ~m);
+	r[2] = (t2 & m) | (s[2] & ~m);
+	r[3] = (t3 & m) | (s[3] & ~m);
+}
+
+SC_TARGET void __sc_reduce(uint8_t *s, const uint8_t *h){
+	uint64_t lo[5], hi[4], u[4], v[4], w[5];
+	u128 t = 0;
+	__sc_load(lo, h);
+	__sc_load(hi, h+32);
+	lo[4] = 0;
+	__sc_montmul(u, hi, SC_R2); //hi 2^256
+	__sc_fold(v, lo);
+	for(int i=0;i<4;i++){
+		t = (u128)u[i] + v[i] + (uint64_t)(t >> 64);
+		w[i] = (uint64_t)t;
+	}
+	w[4] = (uint64_t)(t >> 64);
+	__sc_fold(u, w);
+	__sc_store(s, u);
+}
+
+// (a + b mod 2^256) mod l, the sum wraps like libsodium's so that both
+// backends agree on unreduced inputs
+SC_TARGET void __sc_add(uint8_t *s, const uint8_t *a, const uint8_t *b){
+	uint64_t x[4], y[4], w[5], r[4];
+	u128 t = 0;
+	__sc_load(x, a);
+	__sc_load(y, b);
+	for(int i=0;i<4;i++){
+		t = (u128)x[i] + y[i] + (uint64_t)(t >> 64);
+		w[i] = (uint64_t)t;
+	}
+	w[4] = 0;
+	__sc_fold(r, w);
+	__sc_store(s, r);
+}
+
+// -a mod l, 16l - a is never negative for 256 bit a
+SC_TARGET void __sc_negate(uint8_t *s, const uint8_t *a){
+	uint64_t x[4], w[5], r[4], bw = 0;
+	u128 t;
+	__sc_load(x, a);
+	for(int i=0;i<4;i++){
+		t = (u128)SC_16L[i] - x[i] - bw;
+		w[i] = (uint64_t)t; bw = (uint64_t)(t >> 64) & 1;
+	}
+	w[4] = SC_16L[4] - bw;
+	__sc_fold(r, w);
+	__sc_store(s, r);
+}
+
+// a + (-b), as libsodium does it
+SC_TARGET void __sc_sub(uint8_t *s, const uint8_t *a, const uint8_t *b){
+	uint8_t nb[32];
+	__sc_negate(nb, b);
+	__sc_add(s, a, nb);
+}
+
+// (a 2^256 mod l) b / 2^256 = ab mod l, for any 256 bit a, b
+SC_TARGET void __sc_mul(uint8_t *s, const uint8_t *a, const uint8_t *b){
+	uint64_t x[4], y[4], r[4];
+	__sc_load(x, a);
+	__sc_load(y, b);
+	__sc_montmul(r, x, SC_R2);
+	__sc_montmul(r, r, y);
+	__sc_store(s, r);
+}
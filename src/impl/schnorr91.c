@@ -20,12 +20,18 @@
  * SOFTWARE.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <sodium.h>
 #include "../utils/bufhelp.h"
 #include "../utils/debug.h"
 #include "__crypto.h"
+#include "__ge25519.h"
+#include "__fbase.h"
+#include "__sarena.h"
+#include "__cpool.h"
+#include "__msm.h"
 #include "ds.h"
 #include "schnorr91.h"
 
@@ -33,22 +39,22 @@
 struct __schnorr91_pk *__schnorr91_pkinit(void){
 	struct __schnorr91_pk *out;
 	out = (struct __schnorr91_pk *)malloc( sizeof(struct __schnorr91_pk) );
-	out->A = (uint8_t *)malloc( RRE );
+	out->At = NULL;
+	out->hid = H2S_SHA512;
+	out->ext = 0;
 	return out;
 }
 struct __schnorr91_sk *__schnorr91_skinit(void){
 	struct __schnorr91_sk *out;
-	out = (struct __schnorr91_sk *)malloc( sizeof(struct __schnorr91_sk) );
-	out->a = (uint8_t *)sodium_malloc( RRS );
+	out = (struct __schnorr91_sk *)__sarena_alloc( sizeof(struct __schnorr91_sk) );
 	out->pub = __schnorr91_pkinit();
 	return out;
 }
 struct __schnorr91_sg *__schnorr91_sginit(void){
 	struct __schnorr91_sg *out;
-	out = (struct __schnorr91_sg *)malloc( sizeof( struct __schnorr91_sg) );
-	out->s = (uint8_t *)sodium_malloc( RRS );
-	out->x = (uint8_t *)sodium_malloc( RRS );
-	out->U = (uint8_t *)sodium_malloc( RRE );
+	out = (struct __schnorr91_sg *)__sarena_alloc( sizeof( struct __schnorr91_sg) );
+	out->cp = NULL;
+	out->ext = 0;
 	return out;
 }
 
@@ -57,33 +63,23 @@ void __schnorr91_pkfree(void *in){
 	//key recast
 	struct __schnorr91_pk *ri = (struct __schnorr91_pk *)in;
 	//free up memory
-	free(ri->A);
-	free(ri);
+	__fbase_release(ri->At);
+	if( !ri->ext ) free(ri);
 }
 void __schnorr91_skfree(void *in){
 	//key recast
 	struct __schnorr91_sk *ri = (struct __schnorr91_sk *)in;
-	//zero out the secret component
-	//sodium_memzero(ri->a, RRS); //sodium_free already does this
-
-	//free memory
-	sodium_free(ri->a);
+	//free memory, __sarena_free zeroes the secret
 	__schnorr91_pkfree(ri->pub);
-	free(ri);
+	__sarena_free(ri);
 }
 void __schnorr91_sgfree(void *in){
 	//key recast
 	struct __schnorr91_sg *ri = (struct __schnorr91_sg *)in;
-	//clear the components
-	//sodium_memzero(ri->s, RRS);
-	//sodium_memzero(ri->x, RRS);
-	//sodium_memzero(ri->U, RRE);
-	//free memory
-	sodium_free(ri->s);
-	sodium_free(ri->x);
-	//free(ri->x);
-	sodium_free(ri->U);
-	free(ri);
+	//free memory, __sarena_free zeroes the components
+	__cpool_free(ri->cp);
+	if( ri->ext ) sodium_memzero(ri, sizeof(struct __schnorr91_sg));
+	else __sarena_free(ri);
 }
 
 void __schnorr91_skgen(void **out){
@@ -93,10 +89,10 @@ void __schnorr91_skgen(void **out){
 	uint8_t neg[RRS];
 
 	//sample secret a
-	crypto_core_ristretto255_scalar_random( tmp->a );
+	__cb->scrand( tmp->a );
 
-	crypto_core_ristretto255_scalar_negate(neg , tmp->a);
-	rc = crypto_scalarmult_ristretto255_base(tmp->pub->A, neg); // A = -aB
+	__cb->scneg(neg , tmp->a);
+	rc = __cb->ptbase(tmp->pub->A, neg); // A = -aB
 
 	memset(neg, 0, RRS); // zero memory
 	assert(rc == 0);
@@ -111,9 +107,18 @@ void __schnorr91_pkext(void *vkey, void **out){
 	//allocate for pk
 	struct __schnorr91_pk *tmp = __schnorr91_pkinit();
 	memcpy(tmp->A, key->pub->A, RRE);
+	tmp->At = __fbase_dup(key->pub->At);
+	tmp->hid = key->pub->hid;
 	*out = (void *)tmp;
 }
 
+// decode A once and keep its tables for the verifiers
+int __schnorr91_pkprep(void *in){
+	struct __schnorr91_pk *ri = (struct __schnorr91_pk *)in;
+	if( ri->At == NULL ) ri->At = __fbase_acquire(ri->A, 0);
+	return (ri->At == NULL) ? -1 : 0;
+}
+
 void __schnorr91_siggen(
 	void *vkey,
 	const uint8_t *mbuf, size_t mlen,
@@ -130,25 +135,74 @@ void __schnorr91_siggen(
 	uint8_t nonce[RRS];
 
 	//sample r (MUST RANDOMIZE, else secret key a will be exposed)
-	crypto_core_ristretto255_scalar_random(nonce);
+	__cb->scrand(nonce);
 
-	rc = crypto_scalarmult_ristretto255_base(
+	rc = __cb->ptbase(
 			tmp->U,
 			nonce
 			); // U = rB
 	assert(rc == 0);
 
-	__sodium_2rinhashexec(mbuf, mlen, tmp->U, key->pub->A, tmp->x);
+	__h2s(key->pub->hid, mbuf, mlen, tmp->U, key->pub->A, tmp->x);
 
 	// s = r + xa
-	crypto_core_ristretto255_scalar_mul( tmp->s , tmp->x, key->a );
-	crypto_core_ristretto255_scalar_add( tmp->s, tmp->s, nonce );
+	__cb->scmul( tmp->s , tmp->x, key->a );
+	__cb->scadd( tmp->s, tmp->s, nonce );
 	memset(nonce, 0, RRS);
 	//--------------------------TODO END
 
 	*out = (void *) tmp;
 }
 
+// U = rB for every signature in one pass, four nonces per step
+void __schnorr91_siggen_batch(
+	void *vkey,
+	const uint8_t **mbufs, const size_t *mlens,
+	size_t n, void **out
+){
+	int rc;
+	struct __schnorr91_sk *key = (struct __schnorr91_sk *)vkey;
+	uint8_t *nonce = (uint8_t *)sodium_malloc( n*RRS );
+	uint8_t *U = (uint8_t *)malloc( n*RRE );
+	uint8_t *xs = (uint8_t *)malloc( n*RRS );
+	const uint8_t **ub = (const uint8_t **)malloc( 2*n*sizeof(uint8_t *) );
+	const uint8_t **vb;
+
+	if( nonce == NULL || U == NULL || xs == NULL || ub == NULL ){
+		//out of memory, one at a time
+		for(size_t i=0;i<n;i++) __schnorr91_siggen(vkey, mbufs[i], mlens[i], &out[i]);
+		sodium_free(nonce);
+		free(U); free(xs); free(ub);
+		return;
+	}
+	vb = ub + n;
+
+	for(size_t i=0;i<n;i++) __cb->scrand(nonce + i*RRS);
+	rc = __cb->ptbase_n(n, U, nonce);
+	assert(rc == 0);
+
+	for(size_t i=0;i<n;i++){
+		ub[i] = U + i*RRE;
+		vb[i] = key->pub->A;
+	}
+	__h2s_n(key->pub->hid, n, mbufs, mlens, ub, vb, xs);
+
+	for(size_t i=0;i<n;i++){
+		struct __schnorr91_sg *tmp = __schnorr91_sginit();
+		memcpy(tmp->U, U + i*RRE, RRE);
+		memcpy(tmp->x, xs + i*RRS, RRS);
+		// s = r + xa
+		__cb->scmul( tmp->s, tmp->x, key->a );
+		__cb->scadd( tmp->s, tmp->s, nonce + i*RRS );
+		out[i] = (void *) tmp;
+	}
+
+	sodium_free(nonce);
+	free(U);
+	free(xs);
+	free(ub);
+}
+
 void __schnorr91_sigvrf(
 	void *vpar,
 	void *vsig,
@@ -160,20 +214,132 @@ void __schnorr91_sigvrf(
 	struct __schnorr91_pk *par = (struct __schnorr91_pk *)vpar;
 	struct __schnorr91_sg *sig = (struct __schnorr91_sg *)vsig;
 
-	//--------------------------TODO START
-	uint8_t tmp1[RRE]; //tmp array
-	uint8_t tmp2[RRE]; //tmp array
+	uint8_t tmp1[RRE], sc[2*RRS]; //tmp array
+	const ge_fbase_t *fb[2] = { &__fbase_B, par->At };
+	const size_t nf = (par->At != NULL) ? 2 : 1; //A is a fixed base once prepared
+	ge_p3_t A, r;
 
-	// U' = sB - xA
-	*res = crypto_scalarmult_ristretto255_base( tmp1, sig->s);
-	*res += crypto_scalarmult_ristretto255( tmp2, sig->x, par->A);
-	*res += crypto_core_ristretto255_add( tmp1, tmp1, tmp2 );
+	// U' = sB + xA
+	*res = (nf == 1) ? __ge_frombytes(&A, par->A) : 0;
+	if( *res != 0 ) return;
+	__msm_sc255(sc, sig->s);
+	__msm_sc255(sc+RRS, sig->x);
+	*res = __msm_vartime_fb(&r, sc, fb, nf, sc + nf*RRS, &A, 2 - nf);
+	__ge_tobytes(tmp1, &r);
 
-	__sodium_2rinhashexec(mbuf, mlen, tmp1, par->A, xp);
+	__h2s(par->hid, mbuf, mlen, tmp1, par->A, xp);
 
 	//check if hash is equal to x from vsig
 	*res += crypto_verify_32( xp, sig->x );
-	//--------------------------TODO END
+}
+
+// decoded batch entry
+struct __schnorr91_bent {
+	ge_p3_t A, U;
+	const uint8_t *Ab; //encoded A, entries on the same key share one term
+	const ge_fbase_t *At; //tables of A if the key was prepared
+	const uint8_t *x;
+	uint8_t s[RRS];
+};
+
+// sum z_i( s_i B + x_i A_i - U_i ) == 0 for random 128bit z_i
+int __schnorr91_bchk(void *ctx, const size_t *idx, size_t n){
+	struct __schnorr91_bent *ent = (struct __schnorr91_bent *)ctx;
+	uint8_t *sc = (uint8_t *)calloc( 2*n, RRS );
+	ge_p3_t *pt = (ge_p3_t *)malloc( 2*n*sizeof(ge_p3_t) );
+	const ge_fbase_t *fb[2] = { &__fbase_B, ent[idx[0]].At };
+	const size_t nf = (fb[1] != NULL) ? 2 : 1;
+	uint8_t fsc[2*RRS], z[RRS], t[RRS]; ge_p3_t r;
+	size_t c = 1; int rc;
+
+	if( sc == NULL || pt == NULL ){
+		free(sc); free(pt);
+		return -1; //out of memory, the group fails
+	}
+
+	// term 0: the key of the first entry, fsc[0] is the scalar of B
+	pt[0] = ent[idx[0]].A;
+	memset(fsc, 0, RRS);
+	memset(z, 0, RRS);
+	for(size_t i=0;i<n;i++){
+		struct __schnorr91_bent *e = &ent[idx[i]];
+		__cb->randbytes(z, 16);
+		__cb->scmul(t, z, e->s);
+		__cb->scadd(fsc, fsc, t);
+		__cb->scmul(t, z, e->x);
+		if( memcmp(e->Ab, ent[idx[0]].Ab, RRE) == 0 ){
+			__cb->scadd(sc, sc, t);
+		}else{
+			memcpy(sc + c*RRS, t, RRS);
+			pt[c++] = e->A;
+		}
+		__cb->scneg(sc + c*RRS, z);
+		pt[c++] = e->U;
+	}
+
+	// a prepared first key moves term 0 to the fixed bases
+	memcpy(fsc+RRS, sc, RRS);
+	rc = __msm_vartime_fb(&r, fsc, fb, nf, sc + (nf-1)*RRS, pt + (nf-1), c - (nf-1));
+	if( rc == 0 && !__ge_is_identity(&r) ) rc = -1;
+	free(sc);
+	free(pt);
+	return rc;
+}
+
+void __schnorr91_sigvrf_batch(
+	void **vpars,
+	void **vsigs,
+	const uint8_t **mbufs, const size_t *mlens,
+	size_t n, int *res
+){
+	struct __schnorr91_bent *ent;
+	size_t *idx, c = 0;
+	uint8_t *xp;
+	const uint8_t **ub, **vb;
+
+	ent = (struct __schnorr91_bent *)malloc( n*sizeof(struct __schnorr91_bent) );
+	idx = (size_t *)malloc( n*sizeof(size_t) );
+	xp = (uint8_t *)malloc( n*RRS );
+	ub = (const uint8_t **)malloc( 2*n*sizeof(uint8_t *) );
+	if( ent == NULL || idx == NULL || xp == NULL || ub == NULL ){
+		for(size_t i=0;i<n;i++) res[i] = -1; //out of memory, nothing verified
+		free(ent); free(idx); free(xp); free(ub);
+		return;
+	}
+	vb = ub + n;
+
+	// x = H(m, U, A) is checked up front for every entry, several lanes at once
+	// (batches are grouped by algorithm, the keys share one hash)
+	for(size_t i=0;i<n;i++){
+		ub[i] = ((struct __schnorr91_sg *)vsigs[i])->U;
+		vb[i] = ((struct __schnorr91_pk *)vpars[i])->A;
+	}
+	if( n > 0 ) __h2s_n(((struct __schnorr91_pk *)vpars[0])->hid, n, mbufs, mlens, ub, vb, xp);
+
+	for(size_t i=0;i<n;i++){
+		struct __schnorr91_pk *par = (struct __schnorr91_pk *)vpars[i];
+		struct __schnorr91_sg *sig = (struct __schnorr91_sg *)vsigs[i];
+		res[i] = -1;
+		// U and A must decode
+		if( crypto_verify_32( xp + i*RRS, sig->x ) != 0 ) continue;
+		if( par->At != NULL ){
+			ent[i].A = par->At->P;
+		}else if( __ge_frombytes(&ent[i].A, par->A) != 0 ){
+			continue;
+		}
+		if( __ge_frombytes(&ent[i].U, sig->U) != 0 ) continue;
+		ent[i].Ab = par->A;
+		ent[i].At = par->At;
+		__msm_sc255(ent[i].s, sig->s);
+		ent[i].x = sig->x;
+		idx[c++] = i;
+	}
+
+	__ds_bisect((void *)ent, __schnorr91_bchk, idx, c, res);
+	free(ent);
+	free(idx);
+	free(xp);
+	free(ub);
 }
 
 //debugging use only
@@ -264,12 +430,36 @@ size_t __schnorr91_sgconstr(const uint8_t *in, void **out){
 	return rs;
 }
 
+// views, parsed into caller storage of SCHNORR91_VLEN bytes
+size_t __schnorr91_pkview(const uint8_t *in, size_t len, void *out){
+	struct __schnorr91_pk *tmp = (struct __schnorr91_pk *)out;
+	if( len < SCHNORR91_PKLEN ) return 0;
+	tmp->At = NULL;
+	tmp->hid = H2S_SHA512;
+	tmp->ext = 1;
+	return skipcopy( tmp->A, in, 0, RRE);
+}
+
+size_t __schnorr91_sgview(const uint8_t *in, size_t len, void *out){
+	size_t rs;
+	struct __schnorr91_sg *tmp = (struct __schnorr91_sg *)out;
+	if( len < SCHNORR91_SGLEN ) return 0;
+	tmp->cp = NULL;
+	tmp->ext = 1;
+	rs = skipcopy( tmp->s,		in, 0, 	RRS);
+	rs = skipcopy( tmp->x,		in, rs, RRS);
+	rs = skipcopy( tmp->U,		in, rs, RRE);
+	return rs;
+}
+
 const ds_t schnorr91 = {
 	.hier = 0, //non hierarchical
 	.skgen = __schnorr91_skgen,
 	.pkext = __schnorr91_pkext,
 	.siggen = __schnorr91_siggen,
+	.siggen_batch = __schnorr91_siggen_batch,
 	.sigvrf = __schnorr91_sigvrf,
+	.sigvrf_batch = __schnorr91_sigvrf_batch,
 	.skfree = __schnorr91_skfree,
 	.pkfree = __schnorr91_pkfree,
 	.sgfree = __schnorr91_sgfree,
@@ -282,7 +472,65 @@ const ds_t schnorr91 = {
 	.skconstr = __schnorr91_skconstr,
 	.pkconstr = __schnorr91_pkconstr,
 	.sgconstr = __schnorr91_sgconstr,
+	.pkview = __schnorr91_pkview,
+	.sgview = __schnorr91_sgview,
+	.pkprep = __schnorr91_pkprep,
+	.sklen = SCHNORR91_SKLEN,
+	.pklen = SCHNORR91_PKLEN,
+	.sglen = SCHNORR91_SGLEN,
+	.vlen = SCHNORR91_VLEN,
+};
+
+// schnorr91 hashing with BLAKE2b-512 instead of SHA-512, only the key
+// setup differs as every other function follows the choice on the key
+void __schnorr91b_skgen(void **out){
+	__schnorr91_skgen(out);
+	((struct __schnorr91_sk *)(*out))->pub->hid = H2S_BLAKE2B;
+}
+
+size_t __schnorr91b_pkconstr(const uint8_t *in, void **out){
+	size_t rs = __schnorr91_pkconstr(in, out);
+	((struct __schnorr91_pk *)(*out))->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+size_t __schnorr91b_pkview(const uint8_t *in, size_t len, void *out){
+	size_t rs = __schnorr91_pkview(in, len, out);
+	((struct __schnorr91_pk *)out)->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+size_t __schnorr91b_skconstr(const uint8_t *in, void **out){
+	size_t rs = __schnorr91_skconstr(in, out);
+	((struct __schnorr91_sk *)(*out))->pub->hid = H2S_BLAKE2B;
+	return rs;
+}
+
+const ds_t schnorr91b = {
+	.hier = 0, //non hierarchical
+	.skgen = __schnorr91b_skgen,
+	.pkext = __schnorr91_pkext,
+	.siggen = __schnorr91_siggen,
+	.siggen_batch = __schnorr91_siggen_batch,
+	.sigvrf = __schnorr91_sigvrf,
+	.sigvrf_batch = __schnorr91_sigvrf_batch,
+	.skfree = __schnorr91_skfree,
+	.pkfree = __schnorr91_pkfree,
+	.sgfree = __schnorr91_sgfree,
+	.skprint = __schnorr91_skprint,
+	.pkprint = __schnorr91_pkprint,
+	.sgprint = __schnorr91_sgprint,
+	.skserial = __schnorr91_skserial,
+	.pkserial = __schnorr91_pkserial,
+	.sgserial = __schnorr91_sgserial,
+	.skconstr = __schnorr91b_skconstr,
+	.pkconstr = __schnorr91b_pkconstr,
+	.sgconstr = __schnorr91_sgconstr,
+	.pkview = __schnorr91b_pkview,
+	.sgview = __schnorr91_sgview,
+	.pkprep = __schnorr91_pkprep,
 	.sklen = SCHNORR91_SKLEN,
 	.pklen = SCHNORR91_PKLEN,
 	.sglen = SCHNORR91_SGLEN,
+	.vlen = SCHNORR91_VLEN,
 };
@@ -27,18 +27,31 @@
 #define SCHNORR91_SKLEN RRS+SCHNORR91_PKLEN
 #define SCHNORR91_SGLEN (2*RRS+RRE)
 
+struct __ge_fbase; //precomputed tables, see __fbase.h
+struct __cpool; //prover commitments, see __cpool.h
+
+// keys and signatures are single blocks, the ones holding secrets are
+// taken from the secret arena (__sarena.h). views live in caller storage
 struct __schnorr91_pk {
-	unsigned char *A;
+	unsigned char A[RRE];
+	struct __ge_fbase *At; //prepared A, NULL unless pkprep was called
+	unsigned char hid; //hash-to-scalar, H2S_*
+	unsigned char ext; //view, released but not freed
 };
 
 struct __schnorr91_sk {
 	struct __schnorr91_pk *pub;
-	unsigned char *a;
+	unsigned char a[RRS];
 };
 
 struct __schnorr91_sg {
-	unsigned char *s;
-	unsigned char *x;
-	unsigned char *U; //precomputation
+	unsigned char s[RRS];
+	unsigned char x[RRS];
+	unsigned char U[RRE]; //precomputation
+	struct __cpool *cp; //NULL unless prepared with uprep
+	unsigned char ext; //view, cleared but not freed
 };
+
+#define SCHNORR91_VLEN (sizeof(struct __schnorr91_sg) > sizeof(struct __schnorr91_pk) ? \
+		sizeof(struct __schnorr91_sg) : sizeof(struct __schnorr91_pk))
 #endif
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2020 Chia Jason
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <sodium.h>
+#include "__crypto.h"
+#include "__sha512x.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA512X_X86 1
+#include <immintrin.h>
+#endif
+
+#define SHA512X_LANES 8 //widest supported vector
+
+static const uint64_t __sha512x_K[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+static const uint64_t __sha512x_IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+// one lane: the padded message m || u || v, handed out block by block
+struct __sha512x_lane {
+	const uint8_t *m, *u, *v;
+	size_t mlen, nb; //nb = 0 for an idle lane
+};
+
+static void __sha512x_part(uint8_t *blk, size_t off, const uint8_t *src, size_t s0, size_t len){
+	size_t lo = (s0 > off) ? s0 : off;
+	size_t hi = (s0 + len < off + 128) ? s0 + len : off + 128;
+	if( lo < hi ) memcpy(blk + (lo - off), src + (lo - s0), hi - lo);
+}
+
+// 16 message words of block b
+static void __sha512x_words(uint64_t *w, const struct __sha512x_lane *l, size_t b){
+	uint8_t blk[128] = {0};
+	const size_t len = l->mlen + 2*RRE, off = b*128;
+	__sha512x_part(blk, off, l->m, 0, l->mlen);
+	__sha512x_part(blk, off, l->u, l->mlen, RRE);
+	__sha512x_part(blk, off, l->v, l->mlen + RRE, RRE);
+	if( len >= off && len < off + 128 ) blk[len - off] = 0x80;
+	if( b == l->nb - 1 ){
+		uint64_t bits = (uint64_t)len << 3;
+		blk[119] = (uint8_t)((uint64_t)len >> 61);
+		for(int i=0;i<8;i++) blk[127-i] = (uint8_t)(bits >> (8*i));
+	}
+	for(int i=0;i<16;i++){
+		uint64_t x = 0;
+		for(int j=0;j<8;j++) x = (x << 8) | blk[8*i+j];
+		w[i] = x;
+	}
+}
+
+// digest of a lane's final state, reduced to a scalar
+static void __sha512x_out(uint8_t *out, const uint64_t *st){
+	uint8_t h[RRH];
+	for(int i=0;i<8;i++){
+		for(int j=0;j<8;j++) h[8*i+j] = (uint8_t)(st[i] >> (56 - 8*j));
+	}
+	crypto_core_ristretto255_scalar_reduce(out, h);
+}
+
+#ifdef SHA512X_X86
+
+#define X4_ROR(x, n) _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64-(n)))
+
+// 4 interleaved compressions, w[t][lane]
+__attribute__((target("avx2")))
+static void __sha512x4_compress(uint64_t st[8][4], const uint64_t w[16][4]){
+	__m256i W[16], s[8], a, b, c, d, e, f, g, h, t1, t2;
+	for(int i=0;i<8;i++) s[i] = _mm256_loadu_si256((const __m256i *)st[i]);
+	for(int i=0;i<16;i++) W[i] = _mm256_loadu_si256((const __m256i *)w[i]);
+	a = s[0]; b = s[1]; c = s[2]; d = s[3]; e = s[4]; f = s[5]; g = s[6]; h = s[7];
+	for(int t=0;t<80;t++){
+		__m256i wt;
+		if( t < 16 ){
+			wt = W[t];
+		}else{
+			__m256i w2 = W[(t-2)&15], w15 = W[(t-15)&15];
+			__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(X4_ROR(w2, 19), X4_ROR(w2, 61)), _mm256_srli_epi64(w2, 6));
+			__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(X4_ROR(w15, 1), X4_ROR(w15, 8)), _mm256_srli_epi64(w15, 7));
+			wt = _mm256_add_epi64(_mm256_add_epi64(s1, W[(t-7)&15]), _mm256_add_epi64(s0, W[t&15]));
+			W[t&15] = wt;
+		}
+		t1 = _mm256_xor_si256(_mm256_xor_si256(X4_ROR(e, 14), X4_ROR(e, 18)), X4_ROR(e, 41));
+		t1 = _mm256_add_epi64(_mm256_add_epi64(h, t1), _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)));
+		t1 = _mm256_add_epi64(_mm256_add_epi64(t1, wt), _mm256_set1_epi64x((long long)__sha512x_K[t]));
+		t2 = _mm256_xor_si256(_mm256_xor_si256(X4_ROR(a, 28), X4_ROR(a, 34)), X4_ROR(a, 39));
+		t2 = _mm256_add_epi64(t2, _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b))));
+		h = g; g = f; f = e; e = _mm256_add_epi64(d, t1);
+		d = c; c = b; b = a; a = _mm256_add_epi64(t1, t2);
+	}
+	s[0] = _mm256_add_epi64(s[0], a); s[1] = _mm256_add_epi64(s[1], b);
+	s[2] = _mm256_add_epi64(s[2], c); s[3] = _mm256_add_epi64(s[3], d);
+	s[4] = _mm256_add_epi64(s[4], e); s[5] = _mm256_add_epi64(s[5], f);
+	s[6] = _mm256_add_epi64(s[6], g); s[7] = _mm256_add_epi64(s[7], h);
+	for(int i=0;i<8;i++) _mm256_storeu_si256((__m256i *)st[i], s[i]);
+}
+
+// 8 interleaved compressions, native rotates and 3-input logic
+__attribute__((target("avx512f")))
+static void __sha512x8_compress(uint64_t st[8][8], const uint64_t w[16][8]){
+	__m512i W[16], s[8], a, b, c, d, e, f, g, h, t1, t2;
+	for(int i=0;i<8;i++) s[i] = _mm512_loadu_si512((const void *)st[i]);
+	for(int i=0;i<16;i++) W[i] = _mm512_loadu_si512((const void *)w[i]);
+	a = s[0]; b = s[1]; c = s[2]; d = s[3]; e = s[4]; f = s[5]; g = s[6]; h = s[7];
+	for(int t=0;t<80;t++){
+		__m512i wt;
+		if( t < 16 ){
+			wt = W[t];
+		}else{
+			__m512i w2 = W[(t-2)&15], w15 = W[(t-15)&15];
+			__m512i s1 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w2, 19), _mm512_ror_epi64(w2, 61), _mm512_srli_epi64(w2, 6), 0x96);
+			__m512i s0 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w15, 1), _mm512_ror_epi64(w15, 8), _mm512_srli_epi64(w15, 7), 0x96);
+			wt = _mm512_add_epi64(_mm512_add_epi64(s1, W[(t-7)&15]), _mm512_add_epi64(s0, W[t&15]));
+			W[t&15] = wt;
+		}
+		t1 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(e, 14), _mm512_ror_epi64(e, 18), _mm512_ror_epi64(e, 41), 0x96);
+		t1 = _mm512_add_epi64(_mm512_add_epi64(h, t1), _mm512_ternarylogic_epi64(e, f, g, 0xca)); //ch
+		t1 = _mm512_add_epi64(_mm512_add_epi64(t1, wt), _mm512_set1_epi64((long long)__sha512x_K[t]));
+		t2 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(a, 28), _mm512_ror_epi64(a, 34), _mm512_ror_epi64(a, 39), 0x96);
+		t2 = _mm512_add_epi64(t2, _mm512_ternarylogic_epi64(a, b, c, 0xe8)); //maj
+		h = g; g = f; f = e; e = _mm512_add_epi64(d, t1);
+		d = c; c = b; b = a; a = _mm512_add_epi64(t1, t2);
+	}
+	s[0] = _mm512_add_epi64(s[0], a); s[1] = _mm512_add_epi64(s[1], b);
+	s[2] = _mm512_add_epi64(s[2], c); s[3] = _mm512_add_epi64(s[3], d);
+	s[4] = _mm512_add_epi64(s[4], e); s[5] = _mm512_add_epi64(s[5], f);
+	s[6] = _mm512_add_epi64(s[6], g); s[7] = _mm512_add_epi64(s[7], h);
+	for(int i=0;i<8;i++) _mm512_storeu_si512((void *)st[i], s[i]);
+}
+
+// wrappers with a common signature, state and words are [word][SHA512X_LANES]
+static void __sha512x_c4(uint64_t st[8][SHA512X_LANES], const uint64_t w[16][SHA512X_LANES]){
+	uint64_t s4[8][4], w4[16][4];
+	for(int i=0;i<8;i++) memcpy(s4[i], st[i], sizeof(s4[i]));
+	for(int i=0;i<16;i++) memcpy(w4[i], w[i], sizeof(w4[i]));
+	__sha512x4_compress(s4, (const uint64_t (*)[4])w4);
+	for(int i=0;i<8;i++) memcpy(st[i], s4[i], sizeof(s4[i]));
+}
+
+static void __sha512x_c8(uint64_t st[8][SHA512X_LANES], const uint64_t w[16][SHA512X_LANES]){
+	__sha512x8_compress(st, w);
+}
+
+// lanes per call (0 if neither extension is usable)
+static size_t __sha512x_pick(void (**fn)(uint64_t [8][SHA512X_LANES], const uint64_t [16][SHA512X_LANES])){
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("avx512f") ){
+		*fn = __sha512x_c8;
+		return 8;
+	}
+	if( __builtin_cpu_supports("avx2") ){
+		*fn = __sha512x_c4;
+		return 4;
+	}
+	return 0;
+}
+
+// runs up to w lanes in lock step, finished lanes keep their state
+static void __sha512x_group(
+		void (*fn)(uint64_t [8][SHA512X_LANES], const uint64_t [16][SHA512X_LANES]),
+		size_t w, const struct __sha512x_lane *ln, uint8_t *oarr){
+	uint64_t st[8][SHA512X_LANES], nx[8][SHA512X_LANES], wd[16][SHA512X_LANES], lw[16];
+	size_t nb = 0;
+	for(size_t j=0;j<w;j++) nb = (ln[j].nb > nb) ? ln[j].nb : nb;
+	for(int i=0;i<8;i++){
+		for(size_t j=0;j<SHA512X_LANES;j++) st[i][j] = __sha512x_IV[i];
+	}
+	memset(wd, 0, sizeof(wd));
+	for(size_t b=0;b<nb;b++){
+		for(size_t j=0;j<w;j++){
+			if( b >= ln[j].nb ) continue;
+			__sha512x_words(lw, &ln[j], b);
+			for(int i=0;i<16;i++) wd[i][j] = lw[i];
+		}
+		memcpy(nx, st, sizeof(st));
+		fn(nx, (const uint64_t (*)[SHA512X_LANES])wd);
+		for(size_t j=0;j<w;j++){
+			if( b >= ln[j].nb ) continue;
+			for(int i=0;i<8;i++) st[i][j] = nx[i][j];
+		}
+	}
+	for(size_t j=0;j<w;j++){
+		uint64_t s[8];
+		if( ln[j].nb == 0 ) continue;
+		for(int i=0;i<8;i++) s[i] = st[i][j];
+		__sha512x_out(oarr + j*RRS, s);
+	}
+}
+#endif
+
+void __sha512x_2rinhashexec(size_t n,
+		const uint8_t *const *mbufs, const size_t *mlens,
+		const uint8_t *const *ubufs, const uint8_t *const *vbufs,
+		uint8_t *oarr){
+	size_t i = 0;
+#ifdef SHA512X_X86
+	void (*fn)(uint64_t [8][SHA512X_LANES], const uint64_t [16][SHA512X_LANES]) = NULL;
+	const size_t w = __sha512x_pick(&fn);
+	struct __sha512x_lane ln[SHA512X_LANES];
+	for(;w > 0 && n - i >= 2;i += w){
+		size_t k = (n - i < w) ? n - i : w;
+		memset(ln, 0, sizeof(ln));
+		for(size_t j=0;j<k;j++){
+			ln[j].m = mbufs[i+j];
+			ln[j].u = ubufs[i+j];
+			ln[j].v = vbufs[i+j];
+			ln[j].mlen = mlens[i+j];
+			ln[j].nb = (mlens[i+j] + 2*RRE + 17 + 127) / 128;
+		}
+		__sha512x_group(fn, w, ln, oarr + i*RRS);
+		if( k < w ){
+			i += k;
+			break;
+		}
+	}
+#endif
+	for(;i<n;i++){ //scalar fallback and leftovers
+		__sodium_2rinhashexec(mbufs[i], mlens[i], (uint8_t *)ubufs[i], (uint8_t *)vbufs[i], oarr + i*RRS);
+	}
+}
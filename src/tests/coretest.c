@@ -4,13 +4,127 @@
 
 #include "../core.h"
 #include "../utils/bufhelp.h"
+#include "../impl/__sarena.h"
 #include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#define CTXN 4
+
+static void *ctxpk, *ctxuk;
+
+// sessions on a shared key pair, one thread each on the process context
+static void *ctxrun(void *arg){
+	const ghibc_ctx_t *ctx = ghibc_ctx();
+	unsigned char cmt[200], cha[64], res[200];
+	void *pst, *vst;
+	int rc, *fail = (int *)arg;
+	assert(ctx == ghibc_ctx());
+	*fail = (ctx == NULL);
+	for(int i=0;i<20 && *fail == 0;i++){
+		ctx->ibi->prvinit(ctxuk, &pst);
+		ctx->ibi->cmtgen(&pst, cmt);
+		ctx->ibi->verinit(ctx, ctxpk, (unsigned char *)"alice", 5, &vst);
+		ctx->ibi->chagen(cmt, &vst, cha);
+		ctx->ibi->resgen(cha, pst, res);
+		ctx->ibi->protdc(res, vst, &rc);
+		if(rc != 0) *fail = 1;
+	}
+	return NULL;
+}
 
 int main(int argc, char *argv[]){
 
-	unsigned char buf[64];
+	unsigned char buf[64], b1[32], b2[32];
+	unsigned char *sp[3000];
+	int fd[2];
 
 	ghibc_init();
+	printf("crypto backend: %s\n", gc.backend);
 	gc.randbytes(buf, 64);
 	ucbprint(buf, 64); printf("\n");
+
+	// drbg: fresh output on every call, and a forked child must not
+	// continue the parent's stream
+	gc.randbytes(b1, 32);
+	assert(memcmp(b1, buf, 32) != 0);
+	assert(pipe(fd) == 0);
+	if(fork() == 0){
+		gc.randbytes(b2, 32);
+		write(fd[1], b2, 32);
+		_exit(0);
+	}
+	wait(NULL);
+	assert(read(fd[0], b2, 32) == 32);
+	gc.randbytes(b1, 32);
+	assert(memcmp(b1, b2, 32) != 0);
+	printf("drbg ok\n");
+
+	// secret arena: more slots than one region holds, zeroed when handed out
+	// again, and larger requests from sodium_malloc
+	for(int i=0;i<3000;i++){
+		sp[i] = __sarena_alloc(32 << (i & 3));
+		assert(sp[i] != NULL);
+		memset(sp[i], 0xa5, 32 << (i & 3));
+	}
+	for(int i=0;i<3000;i++) __sarena_free(sp[i]);
+	for(int i=0;i<3000;i++){
+		sp[i] = __sarena_alloc((16 << (i & 3)) + 1);
+		for(int k=0;k<(32 << (i & 3));k++) assert(sp[i][k] == 0);
+	}
+	for(int i=0;i<3000;i++) __sarena_free(sp[i]);
+	sp[0] = __sarena_alloc(300);
+	assert(sp[0] != NULL);
+	memset(sp[0], 1, 300);
+	__sarena_free(sp[0]);
+	__sarena_free(NULL);
+	printf("sarena ok\n");
+
+	// the context: set up once, the same for every thread and gc
+	const ghibc_ctx_t *ctx = ghibc_ctx();
+	ghibc_stats_t st0, st1;
+	pthread_t th[CTXN];
+	int fail[CTXN];
+	void *sk;
+	assert(ctx != NULL && ghibc_init() == 0);
+	assert(ctx->ibi == gc.ibi && ctx->backend == gc.backend);
+	ctx->ibi->setup(0, &sk, &ctxpk);
+	ctx->ibi->issue(sk, (unsigned char *)"alice", 5, &ctxuk);
+	ctx->stats(ctx, &st0);
+	for(int i=0;i<CTXN;i++) assert(pthread_create(&th[i], NULL, ctxrun, &fail[i]) == 0);
+	for(int i=0;i<CTXN;i++){
+		pthread_join(th[i], NULL);
+		assert(fail[i] == 0);
+	}
+	ctx->stats(ctx, &st1);
+	assert(st1.kc_hits + st1.kc_misses == st0.kc_hits + st0.kc_misses + CTXN*20);
+	assert(st1.kc_hits > st0.kc_hits); //the same user key, K is cached
+
+	// a context of its own caches apart from the process one
+	ghibc_ctx_t *own = ghibc_ctx_new();
+	assert(own != NULL && own->ibi == ctx->ibi);
+	for(int i=0;i<3;i++){
+		unsigned char cmt[200], cha[64], res[200];
+		void *pst, *vst;
+		int rc;
+		own->ibi->prvinit(ctxuk, &pst);
+		own->ibi->cmtgen(&pst, cmt);
+		own->ibi->verinit(own, ctxpk, (unsigned char *)"alice", 5, &vst);
+		own->ibi->chagen(cmt, &vst, cha);
+		own->ibi->resgen(cha, pst, res);
+		own->ibi->protdc(res, vst, &rc);
+		assert(rc == 0);
+	}
+	own->stats(own, &st0);
+	assert(st0.kc_hits == 2 && st0.kc_misses == 1 && st0.kc_used == 1);
+	ctx->stats(ctx, &st0);
+	assert(memcmp(&st0, &st1, sizeof(st0)) == 0);
+	ghibc_ctx_free(own);
+	ctx->ibi->ufree(ctxuk);
+	ctx->ibi->kfree(sk);
+	ctx->ibi->kfree(ctxpk);
+	printf("ctx ok\n");
 }
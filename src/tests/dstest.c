@@ -12,6 +12,7 @@
 #include <assert.h>
 
 #define BL 160
+#define BN 33
 
 int main(int argc, char *argv[]){
 
@@ -21,13 +22,13 @@ int main(int argc, char *argv[]){
 	int rc;
 	unsigned char msg[64];
 
-	unsigned char buf[BL];
+	unsigned char buf[BL], kbuf[BL];
 	size_t alen, blen;
 	char *aptr;
 	unsigned char *bptr;
 
 	ghibc_init(); //uses whatev backend we use
-	for(int i=0;i<1;i++){
+	for(int i=0;i<2;i++){
 		printf("testing ds-algo %d\n",i);
 		//gc.init(i);
 		for(int j=0;j<100;j++){
@@ -96,12 +97,56 @@ int main(int argc, char *argv[]){
 			gc.ds->verify(pk, sg, msg, strlen(msg), &rc);
 			assert(rc==0);
 
+			// the same key and signature read under the other hash must fail
+			gc.ds->kfree(sk);
+			blen = gc.ds->kserial(pk, kbuf, BL);
+			kbuf[0] ^= 1; buf[0] ^= 1;
+			gc.ds->kconstr(kbuf, &sk);
+			gc.ds->rfree(sg);
+			gc.ds->rconstr(buf, &sg);
+			gc.ds->verify(sk, sg, msg, strlen(msg), &rc);
+			assert(rc!=0);
+
 			gc.ds->kfree(sk);
 			gc.ds->kfree(pk);
 			gc.ds->rfree(sg);
 		}
 	}
 
+	// batch verification, two keys, two forged entries
+	void *sk2, *pk2;
+	void *bpk[BN], *bsg[BN];
+	const unsigned char *bms[BN];
+	size_t bml[BN];
+	int brc[BN];
+	unsigned char bmsg[BN][16];
+	for(int i=0;i<2;i++){
+		printf("testing ds-algo %d batch\n",i);
+		gc.ds->keygen(i, &sk, &pk);
+		gc.ds->keygen(i, &sk2, &pk2);
+		for(int j=0;j<BN;j++){
+			gc.randbytes(bmsg[j], 16);
+			bpk[j] = (j % 5 == 4) ? pk2 : pk;
+			gc.ds->sign((j % 5 == 4) ? sk2 : sk, bmsg[j], 16, &bsg[j]);
+			bms[j] = bmsg[j];
+			bml[j] = 16;
+		}
+		gc.ds->verify_batch(bpk, bsg, bms, bml, BN, brc);
+		for(int j=0;j<BN;j++) assert(brc[j]==0);
+
+		bmsg[3][0] ^= 1; //wrong message
+		bpk[10] = pk2; //wrong key
+		gc.ds->verify_batch(bpk, bsg, bms, bml, BN, brc);
+		for(int j=0;j<BN;j++){
+			gc.ds->verify(bpk[j], bsg[j], bms[j], bml[j], &rc);
+			assert( (brc[j]==0) == (rc==0) );
+			assert( (brc[j]==0) == (j != 3 && j != 10) );
+			gc.ds->rfree(bsg[j]);
+		}
+		gc.ds->kfree(sk); gc.ds->kfree(pk);
+		gc.ds->kfree(sk2); gc.ds->kfree(pk2);
+	}
+
 	printf("all ok\n");
 }
 
@@ -6,12 +6,91 @@
 #include "../utils/bufhelp.h"
 #include "../utils/jbase64.h"
 //#include "../impl/ibi.h"
+#include "../impl/__msm.h"
+#include "../impl/__ifma.h"
+#include "../impl/__ge4x.h"
+#include "../impl/__crypto.h"
+#include <sodium.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <unistd.h>
 
 #define BL 512
+#define BN 40
+#define MN 24
+
+// deferred decision callback, may run on the queue's thread
+static void dccb(void *arg, int dec){
+	__atomic_store_n((int *)arg, dec, __ATOMIC_SEQ_CST);
+}
+
+// one session of uk against pk up to the response, pushed on q
+// (the verifier's in caller storage if at is set)
+static void dcpush(void *q, void *pk, void *uk, const unsigned char *m, size_t ml, int bad, int at, int *dec){
+	unsigned char cmt[200], cha[64], res[200];
+	max_align_t vss[64];
+	void *pst, *vst = vss;
+	assert(gc.ibi->stlen(gc.ibi->uaread(uk)) <= sizeof(vss));
+	gc.ibi->prvinit(uk, &pst);
+	gc.ibi->cmtgen(&pst, cmt);
+	if(at) gc.ibi->verinit_at(&gc, pk, m, ml, vss);
+	else gc.ibi->verinit(&gc, pk, m, ml, &vst);
+	gc.ibi->chagen(cmt, &vst, cha);
+	gc.ibi->resgen(cha, pst, res);
+	res[5] ^= bad;
+	*dec = 2; //undecided
+	gc.ibi->dcqpush(q, res, vst, dccb, dec);
+}
+
+// the verifier's scalar multiplications (ifma kernel when the cpu has it)
+// against libsodium on random points and scalars
+static void msmcheck(void){
+	unsigned char a[32*MN], b[32], p[32*MN], ref[32], tmp[32], out[32];
+	ge_p3_t pt[MN], r;
+
+	printf("checking scalar multiplications (ifma %s)\n", __ifma_ok() ? "on" : "off");
+	for(int j=0;j<200;j++){
+		for(int k=0;k<MN;k++){
+			crypto_core_ristretto255_random(p + 32*k);
+			crypto_core_ristretto255_scalar_random(a + 32*k);
+			assert(__ge_frombytes(&pt[k], p + 32*k) == 0);
+		}
+		crypto_core_ristretto255_scalar_random(b);
+
+		// aP and aP + bB
+		assert(crypto_scalarmult_ristretto255(ref, a, p) == 0);
+		assert(__ge_scalarmult_vartime(&r, a, pt) == 0);
+		__ge_tobytes(out, &r);
+		assert(memcmp(out, ref, 32) == 0);
+		assert(crypto_scalarmult_ristretto255_base(tmp, b) == 0);
+		crypto_core_ristretto255_add(ref, ref, tmp);
+		assert(__ge_double_scalarmult_vartime(&r, a, pt, b) == 0);
+		__ge_tobytes(out, &r);
+		assert(memcmp(out, ref, 32) == 0);
+
+		// sum a_k P_k + bB over a growing number of terms
+		for(int k=1;k<MN;k++){
+			assert(crypto_scalarmult_ristretto255(tmp, a + 32*k, p + 32*k) == 0);
+			crypto_core_ristretto255_add(ref, ref, tmp);
+		}
+		assert(__msm_vartime(&r, b, a, pt, MN) == 0);
+		__ge_tobytes(out, &r);
+		assert(memcmp(out, ref, 32) == 0);
+	}
+
+	// bulk nB (avx2 lanes when available), n not a multiple of the lane count
+	printf("checking bulk base multiplications (avx2 %s)\n", __ge4x_ok() ? "on" : "off");
+	for(int j=0;j<50;j++){
+		assert(__cb->ptbase_n(MN-1, p, a) == 0);
+		for(int k=0;k<MN-1;k++){
+			assert(crypto_scalarmult_ristretto255_base(ref, a + 32*k) == 0);
+			assert(memcmp(p + 32*k, ref, 32) == 0);
+			crypto_core_ristretto255_scalar_random(a + 32*k);
+		}
+	}
+}
 
 int main(int argc, char *argv[]){
 
@@ -25,6 +104,11 @@ int main(int argc, char *argv[]){
 	unsigned char cha[64];
 	unsigned char res[200];
 	void *pst, *vst;
+	max_align_t pss[64], vss[64]; //caller storage sessions
+	max_align_t kvs[32], uvs[32], bvs[32]; //key views
+	unsigned char vbuf[BL];
+	const unsigned char *vp;
+	size_t vl, ul;
 
 	unsigned char buf[512];
 	size_t alen, blen;
@@ -32,9 +116,13 @@ int main(int argc, char *argv[]){
 	unsigned char *bptr;
 
 	ghibc_init(); //uses whatev backend we use
+	msmcheck();
+	assert(gc.ibi->parinit(2) == 0); //equations split over helper threads
+	msmcheck();
 
-	for(int i=0;i<3;i++){
+	for(int i=0;i<10;i++){
 		printf("testing ibi-algo %d\n",i);
+		assert(gc.ibi->parinit((i & 2) ? 2 : 0) == 0); //helpers on every other pair
 		//gc.init(i);
 		for(int j=0;j<30;j++){
 			gc.randbytes(msg, 64);
@@ -71,6 +159,7 @@ int main(int argc, char *argv[]){
 			assert(blen == gc.ibi->pklen(i));
 			assert(gc.ibi->karead(pk) == i);
 			assert(gc.ibi->ktread(pk) == 1);
+			if(j & 1) assert(gc.ibi->kprep(pk) == 0); //half the runs on a prepared mpk
 
 			// issue
 			gc.ibi->issue(sk, msg, 64, &uk);
@@ -119,12 +208,23 @@ int main(int argc, char *argv[]){
 			gc.ibi->validate(pk, uk, &rc);
 			assert(rc==0);
 
+			// a twin key whose B2 does not decode is rejected, not proven with
+			if(i%5 == 1 || i%5 == 2 || i%5 == 4){
+				size_t bo = (i%5 == 2) ? 132 : 129; //B2 after s1, s2, x and U
+				void *bk = uk;
+				memcpy(vbuf, buf+bo, 32);
+				memset(buf+bo, 0xff, 32);
+				assert(gc.ibi->uconstr(buf, blen, &bk) == 0 && bk == NULL);
+				memcpy(buf+bo, vbuf, 32);
+			}
+
 			gc.ibi->prvinit(uk, &pst);
 			gc.ibi->cmtgen(&pst, cmt);
 			//printf("T1 :"); ucbprint(cmt, gc.ibi->cmtlen(i)); printf("\n");
 
-			gc.ibi->verinit(pk, msg, 64, &vst);
+			gc.ibi->verinit(&gc, pk, msg, 64, &vst);
 			gc.ibi->chagen(cmt, &vst, cha);
+			if(i & 1) gc.ibi->verpre(vst); //precomputed on a new K
 			//printf("T2 :"); ucbprint(cha, gc.ibi->chalen(i)); printf("\n");
 
 			gc.ibi->resgen(cha, pst, res);
@@ -134,10 +234,164 @@ int main(int argc, char *argv[]){
 			//printf("prot : %d\n",rc);
 			assert(rc==0);
 
+			// repeat logins reuse the verifier's cached K, a bad response must still fail
+			// (in either half of y, the short challenge verifiers split it)
+			// with and without the verifier's precomputation
+			for(int k=0;k<6;k++){
+				gc.ibi->prvinit(uk, &pst);
+				gc.ibi->cmtgen(&pst, cmt);
+				gc.ibi->verinit(&gc, pk, msg, 64, &vst);
+				gc.ibi->chagen(cmt, &vst, cha);
+				if(k >= 3) gc.ibi->verpre(vst);
+				gc.ibi->resgen(cha, pst, res);
+				if(k % 3) res[k%3==1 ? 0 : 20] ^= 1;
+				gc.ibi->protdc(res, vst, &rc);
+				assert((rc==0) == (k%3==0));
+			}
+
+			// commitments taken from the prover's pool, and online ones once it runs dry
+			assert(gc.ibi->uprep(uk, 4) == 0);
+			for(int k=0;k<8;k++){
+				gc.ibi->prvinit(uk, &pst);
+				gc.ibi->cmtgen(&pst, cmt);
+				gc.ibi->verinit(&gc, pk, msg, 64, &vst);
+				gc.ibi->chagen(cmt, &vst, cha);
+				gc.ibi->resgen(cha, pst, res);
+				gc.ibi->protdc(res, vst, &rc);
+				assert(rc==0);
+			}
+
+			// sessions in caller storage, reused without allocation
+			assert(gc.ibi->stlen(i) <= sizeof(pss));
+			for(int k=0;k<6;k++){
+				gc.ibi->prvinit_at(uk, pss);
+				pst = pss;
+				gc.ibi->cmtgen(&pst, cmt);
+				gc.ibi->verinit_at(&gc, pk, msg, 64, vss);
+				vst = vss;
+				gc.ibi->chagen(cmt, &vst, cha);
+				if(k & 1) gc.ibi->verpre(vst);
+				gc.ibi->resgen(cha, pst, res);
+				if(k >= 4) res[0] ^= 1;
+				gc.ibi->protdc(res, vst, &rc);
+				assert((rc==0) == (k < 4));
+			}
+
+			// views over serialized keys, for validation and sessions
+			assert(gc.ibi->vlen(i) <= sizeof(kvs) && gc.ibi->vlen(i) <= sizeof(uvs));
+			vl = gc.ibi->kserial(pk, vbuf, BL);
+			assert(gc.ibi->kview(vbuf, vl-1, kvs) == 0); //short
+			assert(gc.ibi->kview(vbuf, vl, kvs) == vl);
+			ul = gc.ibi->userial(uk, vbuf+vl, BL-vl);
+			assert(gc.ibi->uview(vbuf+vl, ul-65, uvs) == 0);
+			assert(gc.ibi->uview(vbuf+vl, ul, uvs) == ul);
+			if(i%5 == 1 || i%5 == 2 || i%5 == 4){
+				//a B2 that does not decode
+				size_t bo = (i%5 == 2) ? 132 : 129;
+				memcpy(cmt, vbuf+vl+bo, 32);
+				memset(vbuf+vl+bo, 0xff, 32);
+				assert(gc.ibi->uview(vbuf+vl, ul, bvs) == 0);
+				memcpy(vbuf+vl+bo, cmt, 32);
+				memcpy(cmt, vbuf+34, 32);
+				memset(vbuf+34, 0xff, 32);
+				assert(gc.ibi->kview(vbuf, vl, bvs) == 0);
+				memcpy(vbuf+34, cmt, 32);
+			}
+			assert(gc.ibi->uaread(uvs) == i);
+			gc.ibi->uiview(uvs, &vp, &alen);
+			assert(alen == 64 && vp == vbuf+vl+ul-64 && memcmp(vp, msg, 64) == 0);
+			if(gc.ibi->ishier(i)){
+				assert(gc.ibi->fqnview(uvs, &vp) == 64 && memcmp(vp, msg, 64) == 0);
+			}
+			if(j & 1) assert(gc.ibi->kprep(kvs) == 0);
+			gc.ibi->validate(kvs, uvs, &rc);
+			assert(rc==0);
+			if(j & 2) assert(gc.ibi->uprep(uvs, 2) == 0);
+			for(int k=0;k<2;k++){
+				gc.ibi->prvinit(uvs, &pst);
+				gc.ibi->cmtgen(&pst, cmt);
+				gc.ibi->verinit(&gc, kvs, msg, 64, &vst);
+				gc.ibi->chagen(cmt, &vst, cha);
+				gc.ibi->resgen(cha, pst, res);
+				gc.ibi->protdc(res, vst, &rc);
+				assert(rc==0);
+			}
+			gc.ibi->ufree(uvs);
+			gc.ibi->kfree(kvs);
+
 			gc.ibi->kfree(pk);
 			gc.ibi->ufree(uk);
 		}
 	}
+	assert(gc.ibi->parinit(0) == 0);
+
+	// batch validation after a master key setup
+	void *buk[BN];
+	int brc[BN];
+	unsigned char bmsg[BN][64];
+	const unsigned char *bm[BN];
+	size_t bl[BN];
+	for(int i=0;i<10;i++){
+		printf("testing ibi-algo %d batch\n",i);
+		gc.ibi->setup(i, &sk, &pk);
+		for(int j=0;j<BN;j++){
+			gc.randbytes(bmsg[j], 64);
+			bm[j] = bmsg[j];
+			bl[j] = 64;
+		}
+		gc.ibi->issue_batch(sk, bm, bl, BN, buk);
+		gc.ibi->validate_batch(pk, buk, BN, brc);
+		for(int j=0;j<BN;j++) assert(brc[j]==0);
+		assert(gc.ibi->kprep(pk) == 0);
+		assert(gc.ibi->kprep(sk) != 0); //public keys only
+		gc.ibi->validate_batch(pk, buk, BN, brc);
+		for(int j=0;j<BN;j++) assert(brc[j]==0);
+
+		//corrupt the identity of two user keys
+		((ibi_u_t *)buk[7])->m[0] ^= 1;
+		((ibi_u_t *)buk[BN-1])->m[5] ^= 1;
+		gc.ibi->validate_batch(pk, buk, BN, brc);
+		for(int j=0;j<BN;j++){
+			assert( (brc[j]==0) == (j != 7 && j != BN-1) );
+			gc.ibi->ufree(buk[j]);
+		}
+		gc.ibi->kfree(sk);
+		gc.ibi->kfree(pk);
+	}
+
+	// deferred decisions: full queues, an explicit flush and the latency bound
+	int dres[BN];
+	void *q;
+	for(int i=0;i<10;i++){
+		printf("testing ibi-algo %d deferred\n",i);
+		gc.ibi->setup(i, &sk, &pk);
+		if(i & 1) assert(gc.ibi->kprep(pk) == 0);
+		gc.ibi->issue_batch(sk, bm, bl, BN, buk);
+		q = gc.ibi->dcqinit(16, 0);
+		assert(q != NULL);
+		for(int j=0;j<BN;j++){
+			dcpush(q, pk, buk[j], bmsg[j], 64, (j % 7 == 3), (j & 1), &dres[j]);
+			//the same identity on another user's key
+			if(j == 11) dcpush(q, pk, buk[j], bmsg[j-1], 64, 0, 1, &rc);
+		}
+		gc.ibi->dcqflush(q);
+		assert(rc != 0);
+		for(int j=0;j<BN;j++) assert( (dres[j]==0) == (j % 7 != 3) );
+		gc.ibi->dcqfree(q);
+
+		q = gc.ibi->dcqinit(64, 2000);
+		assert(q != NULL);
+		dcpush(q, pk, buk[0], bmsg[0], 64, 0, 0, &dres[0]);
+		for(int k=0;k<1000 && __atomic_load_n(&dres[0], __ATOMIC_SEQ_CST) == 2;k++) usleep(1000);
+		assert(__atomic_load_n(&dres[0], __ATOMIC_SEQ_CST) == 0);
+		dcpush(q, pk, buk[1], bmsg[1], 64, 0, 1, &dres[1]);
+		gc.ibi->dcqfree(q); //pending sessions are decided
+		assert(dres[1] == 0);
+
+		for(int j=0;j<BN;j++) gc.ibi->ufree(buk[j]);
+		gc.ibi->kfree(sk);
+		gc.ibi->kfree(pk);
+	}
 
 	printf("all ok\n");
 }
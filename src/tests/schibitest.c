@@ -75,7 +75,7 @@ int main(int argc, char *argv[]){
 	heng04.cmtgen(&pst, cmt);
 	printf("T1 :"); ucbprint(cmt, heng04.cmtlen); printf("\n");
 
-	heng04.verinit(pubkey, msg, strlen(msg), &vst);
+	heng04.verinit(NULL, pubkey, msg, strlen(msg), &vst);
 	heng04.chagen(cmt, &vst, cha);
 	printf("T2 :"); ucbprint(cha, heng04.chalen); printf("\n");
 
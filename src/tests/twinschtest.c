@@ -18,7 +18,7 @@ int main(int argc, char *argv[]){
 	int rc;
 	unsigned char msg[] = "hello world\n";
 
-	unsigned char bptr[160];
+	unsigned char bptr[320];
 	size_t blen;
 
 	unsigned char un0[] = "nusa_subang_authority";
@@ -81,7 +81,7 @@ int main(int argc, char *argv[]){
 	chin15.cmtgen(&pst, cmt);
 	printf("T1 :"); ucbprint(cmt, chin15.cmtlen); printf("\n");
 
-	chin15.verinit(pubkey, msg, strlen(msg), &vst);
+	chin15.verinit(NULL, pubkey, msg, strlen(msg), &vst);
 	chin15.chagen(cmt, &vst, cha);
 	printf("T2 :"); ucbprint(cha, chin15.chalen); printf("\n");
 
@@ -142,7 +142,7 @@ int main(int argc, char *argv[]){
 	vangujar19.cmtgen(&pst, cmt);
 	printf("T1 :"); ucbprint(cmt, vangujar19.cmtlen); printf("\n");
 
-	vangujar19.verinit(pubkey, fqn, blen, &vst);
+	vangujar19.verinit(NULL, pubkey, fqn, blen, &vst);
 	vangujar19.chagen(cmt, &vst, cha);
 	printf("T2 :"); ucbprint(cha, vangujar19.chalen); printf("\n");
 
@@ -153,6 +153,17 @@ int main(int argc, char *argv[]){
 	assert(rc == 0); //OK
 	printf("prot : %d\n",rc);
 
+	// the level sent with the commitment picks the equation, a wrong one fails
+	vangujar19.prvinit(u2, NULL, 0, &pst);
+	vangujar19.cmtgen(&pst, cmt);
+	assert(cmt[vangujar19.cmtlen-1] == 2);
+	cmt[vangujar19.cmtlen-1] = 0;
+	vangujar19.verinit(NULL, pubkey, fqn, blen, &vst);
+	vangujar19.chagen(cmt, &vst, cha);
+	vangujar19.resgen(cha, pst, res);
+	vangujar19.protdc(res, vst, &rc);
+	assert(rc != 0);
+
 	free(fqn);
 	__vangujar19.sgfree(u0);
 	__vangujar19.sgfree(u1);